@@ -14,150 +14,381 @@ const uint8_t c25519_base_y[F25519_SIZE] = {
 	0xb4, 0x86, 0xa0, 0xb8, 0xa1, 0x19, 0xae, 0x20
 };  // the y coordinate of the base point
 
-/* Double an X-coordinate */
-static void xc_double(uint8_t *x3, uint8_t *z3,
-		      const uint8_t *x1, const uint8_t *z1)
-{
-	/* Explicit formulas database: dbl-1987-m
-	 *
-	 * source 1987 Montgomery "Speeding the Pollard and elliptic
-	 *   curve methods of factorization", page 261, fourth display
-	 * compute X3 = (X1^2-Z1^2)^2
-	 * compute Z3 = 4 X1 Z1 (X1^2 + a X1 Z1 + Z1^2)
-	 */
-	uint8_t x1sq[F25519_SIZE];
-	uint8_t z1sq[F25519_SIZE];
-	uint8_t x1z1[F25519_SIZE];
-	uint8_t a[F25519_SIZE];
-
-	f25519_mul__distinct(x1sq, x1, x1);
-	f25519_mul__distinct(z1sq, z1, z1);
-	f25519_mul__distinct(x1z1, x1, z1);
-
-	f25519_sub(a, x1sq, z1sq);
-	f25519_mul__distinct(x3, a, a);
-
-	f25519_mul_c(a, x1z1, 486662);
-	f25519_add(a, x1sq, a);
-	f25519_add(a, z1sq, a);
-	f25519_mul__distinct(x1sq, x1z1, a);
-	f25519_mul_c(z3, x1sq, 4);
-}
-
-/* Differential addition */
-static void xc_diffadd(uint8_t *x5, uint8_t *z5,
-		       const uint8_t *x1, const uint8_t *z1,
-		       const uint8_t *x2, const uint8_t *z2,
-		       const uint8_t *x3, const uint8_t *z3)
+/* Combined double and differential add. Given (x2 : z2) = P and
+ * (x3 : z3) = Q, where x1 = x(Q - P) in affine form, compute 2P and
+ * P + Q in place.
+ */
+static void xc_ladder_step(struct f25519_fe *x2, struct f25519_fe *z2,
+			   struct f25519_fe *x3, struct f25519_fe *z3,
+			   const struct f25519_fe *x1)
 {
-	/* Explicit formulas database: dbl-1987-m3
+	/* RFC 7748, section 5, with a24 = (486662 + 2) / 4:
 	 *
-	 * source 1987 Montgomery "Speeding the Pollard and elliptic curve
-	 *   methods of factorization", page 261, fifth display, plus
-	 *   common-subexpression elimination
-	 * compute A = X2+Z2
-	 * compute B = X2-Z2
+	 * compute A = X2+Z2, AA = A^2
+	 * compute B = X2-Z2, BB = B^2
+	 * compute E = AA-BB
 	 * compute C = X3+Z3
 	 * compute D = X3-Z3
 	 * compute DA = D A
 	 * compute CB = C B
-	 * compute X5 = Z1(DA+CB)^2
-	 * compute Z5 = X1(DA-CB)^2
+	 * compute X3 = (DA+CB)^2
+	 * compute Z3 = X1(DA-CB)^2
+	 * compute X2 = AA BB
+	 * compute Z2 = E(BB + a24 E)
 	 */
-	uint8_t da[F25519_SIZE];
-	uint8_t cb[F25519_SIZE];
-	uint8_t a[F25519_SIZE];
-	uint8_t b[F25519_SIZE];
-
-	f25519_add(a, x2, z2);
-	f25519_sub(b, x3, z3); /* D */
-	f25519_mul__distinct(da, a, b);
-
-	f25519_sub(b, x2, z2);
-	f25519_add(a, x3, z3); /* C */
-	f25519_mul__distinct(cb, a, b);
-
-	f25519_add(a, da, cb);
-	f25519_mul__distinct(b, a, a);
-	f25519_mul__distinct(x5, z1, b);
-
-	f25519_sub(a, da, cb);
-	f25519_mul__distinct(b, a, a);
-	f25519_mul__distinct(z5, x1, b);
+	struct f25519_fe a;
+	struct f25519_fe b;
+	struct f25519_fe c;
+	struct f25519_fe d;
+	struct f25519_fe aa;
+	struct f25519_fe bb;
+
+	f25519_fe_add_lazy(&a, x2, z2);
+	f25519_fe_sub_lazy(&b, x2, z2);
+	f25519_fe_add_lazy(&c, x3, z3);
+	f25519_fe_sub_lazy(&d, x3, z3);
+
+	f25519_fe_sqr(&aa, &a);
+	f25519_fe_sqr(&bb, &b);
+	f25519_fe_mul(&d, &d, &a);	/* DA */
+	f25519_fe_mul(&c, &c, &b);	/* CB */
+
+	f25519_fe_add_lazy(&a, &d, &c);
+	f25519_fe_sqr(x3, &a);
+	f25519_fe_sub_lazy(&b, &d, &c);
+	f25519_fe_sqr(&b, &b);
+	f25519_fe_mul(z3, x1, &b);
+
+	f25519_fe_mul(x2, &aa, &bb);
+	f25519_fe_sub_lazy(&a, &aa, &bb);	/* E */
+	f25519_fe_mul_c(&b, &a, 121666);
+	f25519_fe_add_lazy(&b, &bb, &b);
+	f25519_fe_mul(z2, &a, &b);
 }
 
-static void projective_ladder(
-				uint8_t *xm, uint8_t *zm,
-				uint8_t *xm1, uint8_t *zm1,
-				const uint8_t *q, const uint8_t *e)
+/* On return, (x2 : z2) is eq and (x3 : z3) is (e+1)q. The coordinates
+ * stay in limb form throughout. Bit 255 of e is ignored.
+ */
+static void projective_ladder(struct f25519_fe *x2, struct f25519_fe *z2,
+			      struct f25519_fe *x3, struct f25519_fe *z3,
+			      const uint8_t *qb, const uint8_t *e)
 {
+	struct f25519_fe x1;
+	uint8_t swap = 0;
 	int i;
 
-	/* Note: bit 254 is assumed to be 1 */
-	f25519_copy(xm, q);
+	f25519_fe_frombytes(&x1, qb);
 
-	for (i = 253; i >= 0; i--) {
-		const int bit = (e[i >> 3] >> (i & 7)) & 1;
-		uint8_t xms[F25519_SIZE];
-		uint8_t zms[F25519_SIZE];
+	/* Start from (O, q) */
+	f25519_fe_load(x2, 1);
+	f25519_fe_load(z2, 0);
+	f25519_fe_copy(x3, &x1);
+	f25519_fe_load(z3, 1);
 
-		/* From P_m and P_(m-1), compute P_(2m) and P_(2m-1) */
-		xc_diffadd(xm1, zm1, q, f25519_one, xm, zm, xm1, zm1);
-		xc_double(xm, zm, xm, zm);
+	for (i = 254; i >= 0; i--) {
+		const uint8_t bit = (e[i >> 3] >> (i & 7)) & 1;
 
-		/* Compute P_(2m+1) */
-		xc_diffadd(xms, zms, xm1, zm1, xm, zm, q, f25519_one);
-
-		/* Select:
-		 *   bit = 1 --> (P_(2m+1), P_(2m))
-		 *   bit = 0 --> (P_(2m), P_(2m-1))
+		/* Only swap when the bit differs from the last one, so
+		 * that (x2 : z2) is always the point being doubled.
 		 */
-		f25519_select(xm1, xm1, xm, bit);
-		f25519_select(zm1, zm1, zm, bit);
-		f25519_select(xm, xm, xms, bit);
-		f25519_select(zm, zm, zms, bit);
+		swap ^= bit;
+		f25519_fe_cswap(x2, x3, swap);
+		f25519_fe_cswap(z2, z3, swap);
+		swap = bit;
+
+		xc_ladder_step(x2, z2, x3, z3, &x1);
 	}
+
+	f25519_fe_cswap(x2, x3, swap);
+	f25519_fe_cswap(z2, z3, swap);
 }
 
 void c25519_smult(uint8_t *result, const uint8_t *q, const uint8_t *e)
 {
-	/* Current point: P_m */
-	uint8_t xm[F25519_SIZE];
-	uint8_t zm[F25519_SIZE] = {1};
+	/* eq */
+	struct f25519_fe x2;
+	struct f25519_fe z2;
 
-	/* Predecessor: P_(m-1) */
-	uint8_t xm1[F25519_SIZE] = {1};
-	uint8_t zm1[F25519_SIZE] = {0};
+	/* (e+1)q */
+	struct f25519_fe x3;
+	struct f25519_fe z3;
 
-	projective_ladder(xm, zm, xm1, zm1, q, e);
+	projective_ladder(&x2, &z2, &x3, &z3, q, e);
 
 	/* Freeze out of projective coordinates */
-	f25519_inv__distinct(zm1, zm);
-	f25519_mul__distinct(result, zm1, xm);
-	f25519_normalize(result);
+	f25519_fe_inv(&z3, &z2);
+	f25519_fe_mul(&x2, &x2, &z3);
+	f25519_fe_tobytes(result, &x2);
 }
 
-void c25519_smult_xy(uint8_t *xR, uint8_t *yR, const uint8_t *xP, const uint8_t *yP, const uint8_t *e)
+/* Two independent ladder steps, as xc_ladder_step(), with the field
+ * operations of each issued alternately so that a superscalar core
+ * can overlap them. Each argument points to two elements.
+ */
+static void xc_ladder_step2(struct f25519_fe *x2, struct f25519_fe *z2,
+			    struct f25519_fe *x3, struct f25519_fe *z3,
+			    const struct f25519_fe *x1)
+{
+	struct f25519_fe a[2];
+	struct f25519_fe b[2];
+	struct f25519_fe c[2];
+	struct f25519_fe d[2];
+	struct f25519_fe aa[2];
+	struct f25519_fe bb[2];
+
+	f25519_fe_add_lazy(&a[0], &x2[0], &z2[0]);
+	f25519_fe_add_lazy(&a[1], &x2[1], &z2[1]);
+	f25519_fe_sub_lazy(&b[0], &x2[0], &z2[0]);
+	f25519_fe_sub_lazy(&b[1], &x2[1], &z2[1]);
+	f25519_fe_add_lazy(&c[0], &x3[0], &z3[0]);
+	f25519_fe_add_lazy(&c[1], &x3[1], &z3[1]);
+	f25519_fe_sub_lazy(&d[0], &x3[0], &z3[0]);
+	f25519_fe_sub_lazy(&d[1], &x3[1], &z3[1]);
+
+	f25519_fe_sqr(&aa[0], &a[0]);
+	f25519_fe_sqr(&aa[1], &a[1]);
+	f25519_fe_sqr(&bb[0], &b[0]);
+	f25519_fe_sqr(&bb[1], &b[1]);
+	f25519_fe_mul(&d[0], &d[0], &a[0]);
+	f25519_fe_mul(&d[1], &d[1], &a[1]);
+	f25519_fe_mul(&c[0], &c[0], &b[0]);
+	f25519_fe_mul(&c[1], &c[1], &b[1]);
+
+	f25519_fe_add_lazy(&a[0], &d[0], &c[0]);
+	f25519_fe_add_lazy(&a[1], &d[1], &c[1]);
+	f25519_fe_sqr(&x3[0], &a[0]);
+	f25519_fe_sqr(&x3[1], &a[1]);
+	f25519_fe_sub_lazy(&b[0], &d[0], &c[0]);
+	f25519_fe_sub_lazy(&b[1], &d[1], &c[1]);
+	f25519_fe_sqr(&b[0], &b[0]);
+	f25519_fe_sqr(&b[1], &b[1]);
+	f25519_fe_mul(&z3[0], &x1[0], &b[0]);
+	f25519_fe_mul(&z3[1], &x1[1], &b[1]);
+
+	f25519_fe_mul(&x2[0], &aa[0], &bb[0]);
+	f25519_fe_mul(&x2[1], &aa[1], &bb[1]);
+	f25519_fe_sub_lazy(&a[0], &aa[0], &bb[0]);
+	f25519_fe_sub_lazy(&a[1], &aa[1], &bb[1]);
+	f25519_fe_mul_c(&b[0], &a[0], 121666);
+	f25519_fe_mul_c(&b[1], &a[1], 121666);
+	f25519_fe_add_lazy(&b[0], &bb[0], &b[0]);
+	f25519_fe_add_lazy(&b[1], &bb[1], &b[1]);
+	f25519_fe_mul(&z2[0], &a[0], &b[0]);
+	f25519_fe_mul(&z2[1], &a[1], &b[1]);
+}
+
+void c25519_smult2(uint8_t *result, const uint8_t *q, const uint8_t *e)
+{
+	struct f25519_fe x1[2];
+	struct f25519_fe x2[2];
+	struct f25519_fe z2[2];
+	struct f25519_fe x3[2];
+	struct f25519_fe z3[2];
+	uint8_t zb[2 * F25519_SIZE];
+	uint8_t scratch[2 * F25519_SIZE];
+	uint8_t swap[2] = {0, 0};
+	int i;
+	int k;
+
+	for (k = 0; k < 2; k++) {
+		f25519_fe_frombytes(&x1[k], q + k * F25519_SIZE);
+		f25519_fe_load(&x2[k], 1);
+		f25519_fe_load(&z2[k], 0);
+		f25519_fe_copy(&x3[k], &x1[k]);
+		f25519_fe_load(&z3[k], 1);
+	}
+
+	/* As projective_ladder(), for both at once */
+	for (i = 254; i >= 0; i--) {
+		for (k = 0; k < 2; k++) {
+			const uint8_t *ek = e + k * C25519_EXPONENT_SIZE;
+			const uint8_t bit = (ek[i >> 3] >> (i & 7)) & 1;
+
+			swap[k] ^= bit;
+			f25519_fe_cswap(&x2[k], &x3[k], swap[k]);
+			f25519_fe_cswap(&z2[k], &z3[k], swap[k]);
+			swap[k] = bit;
+		}
+
+		xc_ladder_step2(x2, z2, x3, z3, x1);
+	}
+
+	for (k = 0; k < 2; k++) {
+		f25519_fe_cswap(&x2[k], &x3[k], swap[k]);
+		f25519_fe_cswap(&z2[k], &z3[k], swap[k]);
+	}
+
+	/* Share one inversion. f25519_inv_batch() keeps a zero Z from
+	 * spoiling the other result.
+	 */
+	for (k = 0; k < 2; k++)
+		f25519_fe_tobytes(zb + k * F25519_SIZE, &z2[k]);
+
+	f25519_inv_batch(zb, zb, 2, scratch);
+
+	for (k = 0; k < 2; k++) {
+		f25519_fe_frombytes(&z2[k], zb + k * F25519_SIZE);
+		f25519_fe_mul(&x2[k], &x2[k], &z2[k]);
+		f25519_fe_tobytes(result + k * F25519_SIZE, &x2[k]);
+	}
+}
+
+/* u = (1 + y) / (1 - y), as in morph25519_ey2mx(), which in projective
+ * form is (Z + Y) / (Z - Y). The neutral point gives zero, as the
+ * ladder does.
+ */
+static void edwards_to_u(uint8_t *u, const struct ed25519_pt *p)
+{
+	struct f25519_fe a;
+	struct f25519_fe b;
+
+	f25519_fe_sub(&b, &p->z, &p->y);
+	f25519_fe_inv(&b, &b);
+	f25519_fe_add_lazy(&a, &p->z, &p->y);
+	f25519_fe_mul(&a, &a, &b);
+	f25519_fe_tobytes(u, &a);
+}
+
+void c25519_keygen(uint8_t *pub, const uint8_t *secret)
+{
+	uint8_t e[C25519_EXPONENT_SIZE];
+	struct ed25519_pt p;
+
+	/* The ladder ignores bit 255, so do the same here */
+	memcpy(e, secret, sizeof(e));
+	e[31] &= 127;
+
+	ed25519_smult_base(&p, e);
+	edwards_to_u(pub, &p);
+}
+
+void c25519_peer_init(struct c25519_peer_ctx *ctx, const uint8_t *u)
+{
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
+	uint8_t t[F25519_SIZE];
+	struct ed25519_pt p;
+	uint8_t ok;
+
+	f25519_copy(ctx->u, u);
+
+	/* Map to Edwards form. A point on the twist has no x, and u = -1
+	 * has no image at all (the division by u + 1 yields y = 0). These
+	 * are left to the ladder. The key is public, so it's fine to
+	 * branch on this.
+	 */
+	morph25519_mx2ey(y, u);
+	ok = morph25519_ey2ex(x, y, 0);
+
+	f25519_add(t, u, f25519_one);
+	f25519_normalize(t);
+	ok &= !f25519_eq(t, f25519_zero);
+
+	ctx->use_table = ok;
+	if (!ok)
+		return;
+
+	ed25519_project(&p, x, y);
+	ed25519_niels_table(ctx->table, &p);
+}
+
+void c25519_peer_smult(uint8_t *result, const struct c25519_peer_ctx *ctx,
+		       const uint8_t *e)
+{
+	uint8_t ec[C25519_EXPONENT_SIZE];
+	struct ed25519_pt p;
+
+	if (!ctx->use_table) {
+		c25519_smult(result, ctx->u, e);
+		return;
+	}
+
+	/* As in c25519_keygen(), bit 255 is ignored */
+	memcpy(ec, e, sizeof(ec));
+	ec[31] &= 127;
+
+	ed25519_smult_niels(&p, ctx->table, ec);
+	edwards_to_u(result, &p);
+}
+
+/* Compute eP in projective (X : Y : Z) form */
+static void smult_xy_projective(uint8_t *xQ, uint8_t *yQ, uint8_t *zQ,
+				const uint8_t *xP, const uint8_t *yP,
+				const uint8_t *e)
 {
-	/* Current point: P_m */
-	uint8_t xm[F25519_SIZE];
-	uint8_t zm[F25519_SIZE] = {1};
+	/* eP */
+	struct f25519_fe x2;
+	struct f25519_fe z2;
 
-	/* Predecessor: P_(m-1) */
-	uint8_t xm1[F25519_SIZE] = {1};
-	uint8_t zm1[F25519_SIZE] = {0};
+	/* (e+1)P */
+	struct f25519_fe x3;
+	struct f25519_fe z3;
 
 	/* Calculate x(P) using Montgomery ladder */
-	projective_ladder(xm, zm, xm1, zm1, xP, e);
+	projective_ladder(&x2, &z2, &x3, &z3, xP, e);
+
+	/* Recover y-coordinate. This needs x(P + eP), not x(eP - P). */
+	uint8_t XQ[F25519_SIZE], ZQ[F25519_SIZE];
+	uint8_t xD[F25519_SIZE], zD[F25519_SIZE];
+	f25519_fe_tobytes(XQ, &x2);
+	f25519_fe_tobytes(ZQ, &z2);
+	f25519_fe_tobytes(xD, &x3);
+	f25519_fe_tobytes(zD, &z3);
+
+	morph25519_montgomery_recovery(xQ, yQ, zQ, xP, yP, XQ, ZQ, xD, zD);
+}
 
-	/* Recover y-coordinate */
+void c25519_smult_xy(uint8_t *xR, uint8_t *yR, const uint8_t *xP, const uint8_t *yP, const uint8_t *e)
+{
 	uint8_t xQ[F25519_SIZE], yQ[F25519_SIZE], zQ[F25519_SIZE];
-	morph25519_montgomery_recovery(xQ, yQ, zQ, xP, yP, xm, zm, xm1, zm1);
+	uint8_t ZQ[F25519_SIZE];
+
+	smult_xy_projective(xQ, yQ, zQ, xP, yP, e);
 
 	/* Freeze out of projective coordinates */
-	f25519_inv__distinct(zm, zQ);
-	f25519_mul__distinct(xR, zm, xQ);
-	f25519_mul__distinct(yR, zm, yQ);
+	f25519_inv__distinct(ZQ, zQ);
+	f25519_mul__distinct(xR, ZQ, xQ);
+	f25519_mul__distinct(yR, ZQ, yQ);
 	f25519_normalize(xR);
 	f25519_normalize(yR);
-}
\ No newline at end of file
+}
+
+void c25519_smult_xy_batch(uint8_t *xR, uint8_t *yR,
+			   const uint8_t *xP, const uint8_t *yP,
+			   const uint8_t *e, size_t n, uint8_t *scratch)
+{
+	uint8_t *zQ = scratch;
+	size_t i;
+
+	/* Leave X and Y in the output arrays, and Z in scratch. The
+	 * recovery writes Y before it has finished reading yP, so go
+	 * through temporaries in case the arrays are shared.
+	 */
+	for (i = 0; i < n; i++) {
+		uint8_t xQ[F25519_SIZE], yQ[F25519_SIZE];
+
+		smult_xy_projective(xQ, yQ, zQ + i * F25519_SIZE,
+				    xP + i * F25519_SIZE,
+				    yP + i * F25519_SIZE,
+				    e + i * C25519_EXPONENT_SIZE);
+		f25519_copy(xR + i * F25519_SIZE, xQ);
+		f25519_copy(yR + i * F25519_SIZE, yQ);
+	}
+
+	f25519_inv_batch(zQ, zQ, n, scratch + n * F25519_SIZE);
+
+	for (i = 0; i < n; i++) {
+		uint8_t *xi = xR + i * F25519_SIZE;
+		uint8_t *yi = yR + i * F25519_SIZE;
+		struct f25519_fe z1;
+		struct f25519_fe a;
+
+		f25519_fe_frombytes(&z1, zQ + i * F25519_SIZE);
+		f25519_fe_frombytes(&a, xi);
+		f25519_fe_mul(&a, &a, &z1);
+		f25519_fe_tobytes(xi, &a);
+		f25519_fe_frombytes(&a, yi);
+		f25519_fe_mul(&a, &a, &z1);
+		f25519_fe_tobytes(yi, &a);
+	}
+}
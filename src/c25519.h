@@ -10,6 +10,7 @@
 #include <stdint.h>
 #include "f25519.h"
 #include "morph25519.h"
+#include "ed25519.h"
 
 /* Curve25519 has the equation over F(p = 2^255-19):
  *
@@ -48,9 +49,76 @@ extern const uint8_t c25519_base_y[F25519_SIZE];
  */
 void c25519_smult(uint8_t *result, const uint8_t *q, const uint8_t *e);
 
+/* Compute the public key for a secret, using a precomputed table for
+ * the base point. This gives the same result as
+ * c25519_smult(pub, c25519_base_x, secret), several times faster.
+ */
+void c25519_keygen(uint8_t *pub, const uint8_t *secret);
+
+/* Precomputed state for repeated scalar multiplies of the same point,
+ * such as a peer's static public key. The point is converted to
+ * Edwards form once, and a fixed-window table of its multiples is
+ * stored, so that c25519_peer_smult() costs about as much as
+ * c25519_keygen() rather than c25519_smult().
+ *
+ * The table takes ED25519_NIELS_TABLE_SIZE * 3 field elements. With
+ * the limb backends (F25519_RADIX 25 or 51), sizeof(struct
+ * c25519_peer_ctx) is about 30 kB, and with F25519_RADIX=8 it is about
+ * 24 kB. Building it costs about as much as five c25519_smult() calls,
+ * so it pays for itself after eight or so multiplies.
+ *
+ * Points on the quadratic twist, and u = -1, have no Edwards
+ * counterpart. For these, no table is built and c25519_peer_smult()
+ * falls back to the ladder, so that results always match
+ * c25519_smult().
+ */
+struct c25519_peer_ctx {
+	struct ed25519_niels	table[ED25519_NIELS_TABLE_SIZE];
+	uint8_t			u[F25519_SIZE];
+	uint8_t			use_table;
+};
+
+void c25519_peer_init(struct c25519_peer_ctx *ctx, const uint8_t *u);
+
+/* Equivalent to c25519_smult(result, u, e), for the u given to
+ * c25519_peer_init().
+ */
+void c25519_peer_smult(uint8_t *result, const struct c25519_peer_ctx *ctx,
+		       const uint8_t *e);
+
+/* Compute two independent X-coordinate scalar multiplies in one
+ * interleaved ladder. result, q and e are arrays of two field elements
+ * or exponents, laid out as for c25519_smult_x4(), and the results are
+ * the same as from c25519_smult(). This needs no vector unit: the two
+ * ladders' field operations alternate, so that each fills the other's
+ * pipeline stalls.
+ */
+void c25519_smult2(uint8_t *result, const uint8_t *q, const uint8_t *e);
+
+/* Compute 4 or 8 independent X-coordinate scalar multiplies at once.
+ * result, q and e are arrays of consecutive field elements and
+ * exponents, and result[i] = c25519_smult(q[i], e[i]), bit for bit.
+ *
+ * On x86-64, the ladders run side by side in AVX2 or AVX-512 lanes,
+ * if the CPU supports it. Otherwise, c25519_smult() is called for each
+ * one. This is implemented in c25519_mb.c, which must be linked in.
+ */
+void c25519_smult_x4(uint8_t *result, const uint8_t *q, const uint8_t *e);
+void c25519_smult_x8(uint8_t *result, const uint8_t *q, const uint8_t *e);
+
 /*
  * Full scalar multiply: given (xP, yP), return (xR, yR) of e*P
  */
 void c25519_smult_xy(uint8_t *xR, uint8_t *yR, const uint8_t *xP, const uint8_t *yP, const uint8_t *e);
 
+/* Full scalar multiply of n points, sharing a single field inversion.
+ * All arguments are arrays of n consecutive field elements, except e,
+ * which holds n exponents. scratch must have room for 2n field
+ * elements (2 * n * F25519_SIZE bytes). xR and yR may be the same
+ * arrays as xP and yP.
+ */
+void c25519_smult_xy_batch(uint8_t *xR, uint8_t *yR,
+			   const uint8_t *xP, const uint8_t *yP,
+			   const uint8_t *e, size_t n, uint8_t *scratch);
+
 #endif
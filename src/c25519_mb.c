@@ -0,0 +1,215 @@
+/* Curve25519 multi-buffer scalar multiplication
+ *
+ * This file is in the public domain.
+ */
+
+#include "c25519.h"
+
+/* The vector paths need GCC-style target attributes and x86-64. They
+ * are chosen at run time, so the rest of the build needs no special
+ * flags. Define C25519_MB_X86 to 0 to leave them out.
+ */
+#ifndef C25519_MB_X86
+#if defined(__GNUC__) && defined(__x86_64__)
+#define C25519_MB_X86  1
+#else
+#define C25519_MB_X86  0
+#endif
+#endif
+
+#if C25519_MB_X86
+
+#include <immintrin.h>
+
+/* The multipliers are written as loops over limbs, but are only fast
+ * when fully unrolled.
+ */
+#define MB_UNROLL  _Pragma("GCC unroll 10")
+
+/* Widest vector, in lanes */
+#define MB_MAX  8
+
+#define MB_MASK26  ((((uint64_t)1) << 26) - 1)
+#define MB_MASK25  ((((uint64_t)1) << 25) - 1)
+
+/* 2p in radix 2^25.5 */
+static const uint64_t mb_two_p[10] = {
+	0x7ffffda, 0x3fffffe, 0x7fffffe, 0x3fffffe, 0x7fffffe,
+	0x3fffffe, 0x7fffffe, 0x3fffffe, 0x7fffffe, 0x3fffffe
+};
+
+static uint32_t mb_load32(const uint8_t *x)
+{
+	return ((uint32_t)x[0]) | (((uint32_t)x[1]) << 8) |
+	       (((uint32_t)x[2]) << 16) | (((uint32_t)x[3]) << 24);
+}
+
+/* Unpack bytes into limbs l[0], l[stride], ... l[9 * stride]. As in
+ * f25519.c, bit 255 is kept in the top limb.
+ */
+static void mb_unpack(uint64_t *l, int stride, const uint8_t *x)
+{
+	l[0 * stride] = mb_load32(x) & MB_MASK26;
+	l[1 * stride] = (mb_load32(x + 3) >> 2) & MB_MASK25;
+	l[2 * stride] = (mb_load32(x + 6) >> 3) & MB_MASK26;
+	l[3 * stride] = (mb_load32(x + 9) >> 5) & MB_MASK25;
+	l[4 * stride] = (mb_load32(x + 12) >> 6) & MB_MASK26;
+	l[5 * stride] = mb_load32(x + 16) & MB_MASK25;
+	l[6 * stride] = (mb_load32(x + 19) >> 1) & MB_MASK26;
+	l[7 * stride] = (mb_load32(x + 22) >> 3) & MB_MASK25;
+	l[8 * stride] = (mb_load32(x + 25) >> 4) & MB_MASK26;
+	l[9 * stride] = mb_load32(x + 28) >> 6;
+}
+
+/* Pack limbs from the ladder into a 256-bit string. This need not be
+ * fully reduced, since it's only passed to f25519_fe_frombytes().
+ */
+static void mb_pack(uint8_t *x, const uint64_t *in, int stride)
+{
+	uint64_t l[10];
+	uint64_t acc = 0;
+	int bits = 0;
+	int i;
+	int j = 0;
+
+	for (i = 0; i < 10; i++)
+		l[i] = in[i * stride];
+
+	/* One pass leaves every limb within its width, except that the
+	 * carry folded into l[0] goes no further than l[1]. The limbs
+	 * are then summed, rather than or-ed, into place.
+	 */
+	for (i = 0; i < 9; i++) {
+		const int w = (i & 1) ? 25 : 26;
+
+		l[i + 1] += l[i] >> w;
+		l[i] &= (((uint64_t)1) << w) - 1;
+	}
+
+	l[0] += (l[9] >> 25) * 19;
+	l[9] &= MB_MASK25;
+	l[1] += l[0] >> 26;
+	l[0] &= MB_MASK26;
+
+	for (i = 0; i < 10; i++) {
+		acc += l[i] << bits;
+		bits += (i & 1) ? 25 : 26;
+
+		while (bits >= 8) {
+			x[j++] = acc;
+			acc >>= 8;
+			bits -= 8;
+		}
+	}
+
+	x[j] = acc;
+}
+
+/* Convert n projective results (limbs interleaved by lane) to affine
+ * X-coordinates, with one shared inversion.
+ */
+static void mb_finish(uint8_t *result, const uint64_t *x, const uint64_t *z,
+		      int n)
+{
+	uint8_t zb[MB_MAX * F25519_SIZE];
+	uint8_t scratch[MB_MAX * F25519_SIZE];
+	int l;
+
+	for (l = 0; l < n; l++)
+		mb_pack(zb + l * F25519_SIZE, z + l, n);
+
+	f25519_inv_batch(zb, zb, n, scratch);
+
+	for (l = 0; l < n; l++) {
+		uint8_t xb[F25519_SIZE];
+		struct f25519_fe a;
+		struct f25519_fe b;
+
+		mb_pack(xb, x + l, n);
+		f25519_fe_frombytes(&a, xb);
+		f25519_fe_frombytes(&b, zb + l * F25519_SIZE);
+		f25519_fe_mul(&a, &a, &b);
+		f25519_fe_tobytes(result + l * F25519_SIZE, &a);
+	}
+}
+
+#define MB_LANES	4
+#define MB_VEC		__m256i
+#define MB_TARGET	__attribute__((target("avx2")))
+#define MB_NAME(x)	mb_##x##_avx2
+#define MB_ADD(a, b)	_mm256_add_epi64(a, b)
+#define MB_SUB(a, b)	_mm256_sub_epi64(a, b)
+#define MB_MUL(a, b)	_mm256_mul_epu32(a, b)
+#define MB_AND(a, b)	_mm256_and_si256(a, b)
+#define MB_XOR(a, b)	_mm256_xor_si256(a, b)
+#define MB_SRL(a, n)	_mm256_srli_epi64(a, n)
+#define MB_SLL(a, n)	_mm256_slli_epi64(a, n)
+#define MB_SET1(c)	_mm256_set1_epi64x(c)
+#define MB_LOAD(p)	_mm256_loadu_si256((const __m256i *)(p))
+#define MB_STORE(p, a)	_mm256_storeu_si256((__m256i *)(p), a)
+
+#include "c25519_mb_ladder.h"
+
+#undef MB_LANES
+#undef MB_VEC
+#undef MB_TARGET
+#undef MB_NAME
+#undef MB_ADD
+#undef MB_SUB
+#undef MB_MUL
+#undef MB_AND
+#undef MB_XOR
+#undef MB_SRL
+#undef MB_SLL
+#undef MB_SET1
+#undef MB_LOAD
+#undef MB_STORE
+
+#define MB_LANES	8
+#define MB_VEC		__m512i
+#define MB_TARGET	__attribute__((target("avx512f")))
+#define MB_NAME(x)	mb_##x##_avx512
+#define MB_ADD(a, b)	_mm512_add_epi64(a, b)
+#define MB_SUB(a, b)	_mm512_sub_epi64(a, b)
+#define MB_MUL(a, b)	_mm512_mul_epu32(a, b)
+#define MB_AND(a, b)	_mm512_and_si512(a, b)
+#define MB_XOR(a, b)	_mm512_xor_si512(a, b)
+#define MB_SRL(a, n)	_mm512_srli_epi64(a, n)
+#define MB_SLL(a, n)	_mm512_slli_epi64(a, n)
+#define MB_SET1(c)	_mm512_set1_epi64(c)
+#define MB_LOAD(p)	_mm512_loadu_si512((const void *)(p))
+#define MB_STORE(p, a)	_mm512_storeu_si512((void *)(p), a)
+
+#include "c25519_mb_ladder.h"
+
+#endif
+
+void c25519_smult_x4(uint8_t *result, const uint8_t *q, const uint8_t *e)
+{
+	int i;
+
+#if C25519_MB_X86
+	if (__builtin_cpu_supports("avx2")) {
+		mb_smult_avx2(result, q, e);
+		return;
+	}
+#endif
+
+	for (i = 0; i < 4; i++)
+		c25519_smult(result + i * F25519_SIZE, q + i * F25519_SIZE,
+			     e + i * C25519_EXPONENT_SIZE);
+}
+
+void c25519_smult_x8(uint8_t *result, const uint8_t *q, const uint8_t *e)
+{
+#if C25519_MB_X86
+	if (__builtin_cpu_supports("avx512f")) {
+		mb_smult_avx512(result, q, e);
+		return;
+	}
+#endif
+
+	c25519_smult_x4(result, q, e);
+	c25519_smult_x4(result + 4 * F25519_SIZE, q + 4 * F25519_SIZE,
+			e + 4 * C25519_EXPONENT_SIZE);
+}
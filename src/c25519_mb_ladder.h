@@ -0,0 +1,297 @@
+/* Curve25519 multi-buffer ladder
+ *
+ * This file is in the public domain.
+ */
+
+/* This is not a normal header. It is included by c25519_mb.c once for
+ * each vector width, with the following defined:
+ *
+ *     MB_LANES         number of 64-bit lanes in a vector
+ *     MB_VEC           vector type
+ *     MB_TARGET        function attribute enabling the instruction set
+ *     MB_NAME(x)       name of x for this width
+ *     MB_ADD(a, b)     lane-wise 64-bit addition
+ *     MB_SUB(a, b)     lane-wise 64-bit subtraction
+ *     MB_MUL(a, b)     lane-wise product of the low 32 bits of a and b
+ *     MB_AND(a, b)     bitwise and
+ *     MB_XOR(a, b)     bitwise exclusive or
+ *     MB_SRL(a, n)     lane-wise logical right shift by a constant
+ *     MB_SLL(a, n)     lane-wise left shift by a constant
+ *     MB_SET1(c)       broadcast a 64-bit constant
+ *     MB_LOAD(p)       unaligned load of MB_LANES uint64_t values
+ *     MB_STORE(p, a)   unaligned store of MB_LANES uint64_t values
+ *
+ * Each lane holds one field element in the same radix 2^25.5 form as
+ * the 32-bit f25519 backend, with limbs widened to 64 bits, and the
+ * arithmetic below is that backend's, lane by lane. The bounds on
+ * limbs are therefore the same, and in particular every multiplier
+ * operand fits in 32 bits.
+ */
+
+struct MB_NAME(fe) {
+	MB_VEC	v[10];
+};
+
+/* Fold column sums into reduced limbs, as carry_wide() in f25519.c */
+static MB_TARGET void MB_NAME(carry_wide)(struct MB_NAME(fe) *r, MB_VEC *t)
+{
+	const MB_VEC m26 = MB_SET1((1 << 26) - 1);
+	const MB_VEC m25 = MB_SET1((1 << 25) - 1);
+	MB_VEC c;
+	int i;
+
+	MB_UNROLL
+	for (i = 0; i < 9; i++) {
+		if (i & 1) {
+			t[i + 1] = MB_ADD(t[i + 1], MB_SRL(t[i], 25));
+			r->v[i] = MB_AND(t[i], m25);
+		} else {
+			t[i + 1] = MB_ADD(t[i + 1], MB_SRL(t[i], 26));
+			r->v[i] = MB_AND(t[i], m26);
+		}
+	}
+
+	/* c * 19, where c may be wider than 32 bits */
+	c = MB_SRL(t[9], 25);
+	c = MB_ADD(c, MB_ADD(MB_SLL(c, 1), MB_SLL(c, 4)));
+	c = MB_ADD(r->v[0], c);
+
+	r->v[9] = MB_AND(t[9], m25);
+	r->v[0] = MB_AND(c, m26);
+	r->v[1] = MB_ADD(r->v[1], MB_SRL(c, 26));
+}
+
+static MB_TARGET void MB_NAME(mul)(struct MB_NAME(fe) *r,
+				   const struct MB_NAME(fe) *a,
+				   const struct MB_NAME(fe) *b)
+{
+	/* As mul_limbs() in f25519.c: a product of two odd limbs is
+	 * doubled, and anything at or above 2^255 is folded back as 19.
+	 */
+	MB_VEC b19[10];
+	MB_VEC t[10];
+	int i;
+	int j;
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++) {
+		b19[i] = MB_ADD(b->v[i],
+				MB_ADD(MB_SLL(b->v[i], 1), MB_SLL(b->v[i], 4)));
+		t[i] = MB_SET1(0);
+	}
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++) {
+		const MB_VEC ai = a->v[i];
+		const MB_VEC ai2 = (i & 1) ? MB_SLL(ai, 1) : ai;
+
+		MB_UNROLL
+		for (j = 0; j < 10; j++) {
+			const MB_VEC x = (j & 1) ? ai2 : ai;
+
+			if (i + j < 10)
+				t[i + j] = MB_ADD(t[i + j],
+						  MB_MUL(x, b->v[j]));
+			else
+				t[i + j - 10] = MB_ADD(t[i + j - 10],
+						       MB_MUL(x, b19[j]));
+		}
+	}
+
+	MB_NAME(carry_wide)(r, t);
+}
+
+static MB_TARGET void MB_NAME(sqr)(struct MB_NAME(fe) *r,
+				   const struct MB_NAME(fe) *a)
+{
+	/* As above, but each cross product is computed only once */
+	MB_VEC a19[10];
+	MB_VEC t[10];
+	int i;
+	int j;
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++) {
+		a19[i] = MB_ADD(a->v[i],
+				MB_ADD(MB_SLL(a->v[i], 1), MB_SLL(a->v[i], 4)));
+		t[i] = MB_SET1(0);
+	}
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++) {
+		MB_UNROLL
+		for (j = i; j < 10; j++) {
+			const int shift = (i != j) + (i & j & 1);
+			const MB_VEC x = shift == 2 ? MB_SLL(a->v[i], 2) :
+					 shift == 1 ? MB_SLL(a->v[i], 1) :
+					 a->v[i];
+
+			if (i + j < 10)
+				t[i + j] = MB_ADD(t[i + j],
+						  MB_MUL(x, a->v[j]));
+			else
+				t[i + j - 10] = MB_ADD(t[i + j - 10],
+						       MB_MUL(x, a19[j]));
+		}
+	}
+
+	MB_NAME(carry_wide)(r, t);
+}
+
+static MB_TARGET void MB_NAME(mul_c)(struct MB_NAME(fe) *r,
+				     const struct MB_NAME(fe) *a, uint32_t c)
+{
+	const MB_VEC vc = MB_SET1(c);
+	MB_VEC t[10];
+	int i;
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++)
+		t[i] = MB_MUL(a->v[i], vc);
+
+	MB_NAME(carry_wide)(r, t);
+}
+
+static MB_TARGET void MB_NAME(add_lazy)(struct MB_NAME(fe) *r,
+					const struct MB_NAME(fe) *a,
+					const struct MB_NAME(fe) *b)
+{
+	int i;
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++)
+		r->v[i] = MB_ADD(a->v[i], b->v[i]);
+}
+
+/* a + 2p - b, for a carried b */
+static MB_TARGET void MB_NAME(sub_lazy)(struct MB_NAME(fe) *r,
+					const struct MB_NAME(fe) *a,
+					const struct MB_NAME(fe) *b)
+{
+	int i;
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++)
+		r->v[i] = MB_SUB(MB_ADD(a->v[i], MB_SET1(mb_two_p[i])),
+				 b->v[i]);
+}
+
+static MB_TARGET void MB_NAME(cswap)(struct MB_NAME(fe) *a,
+				     struct MB_NAME(fe) *b, MB_VEC mask)
+{
+	int i;
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++) {
+		const MB_VEC t = MB_AND(mask, MB_XOR(a->v[i], b->v[i]));
+
+		a->v[i] = MB_XOR(a->v[i], t);
+		b->v[i] = MB_XOR(b->v[i], t);
+	}
+}
+
+/* Same as xc_ladder_step() in c25519.c */
+static MB_TARGET void MB_NAME(ladder_step)(struct MB_NAME(fe) *x2,
+					   struct MB_NAME(fe) *z2,
+					   struct MB_NAME(fe) *x3,
+					   struct MB_NAME(fe) *z3,
+					   const struct MB_NAME(fe) *x1)
+{
+	struct MB_NAME(fe) a;
+	struct MB_NAME(fe) b;
+	struct MB_NAME(fe) c;
+	struct MB_NAME(fe) d;
+	struct MB_NAME(fe) aa;
+	struct MB_NAME(fe) bb;
+
+	MB_NAME(add_lazy)(&a, x2, z2);
+	MB_NAME(sub_lazy)(&b, x2, z2);
+	MB_NAME(add_lazy)(&c, x3, z3);
+	MB_NAME(sub_lazy)(&d, x3, z3);
+
+	MB_NAME(sqr)(&aa, &a);
+	MB_NAME(sqr)(&bb, &b);
+	MB_NAME(mul)(&d, &d, &a);	/* DA */
+	MB_NAME(mul)(&c, &c, &b);	/* CB */
+
+	MB_NAME(add_lazy)(&a, &d, &c);
+	MB_NAME(sqr)(x3, &a);
+	MB_NAME(sub_lazy)(&b, &d, &c);
+	MB_NAME(sqr)(&b, &b);
+	MB_NAME(mul)(z3, x1, &b);
+
+	MB_NAME(mul)(x2, &aa, &bb);
+	MB_NAME(sub_lazy)(&a, &aa, &bb);	/* E */
+	MB_NAME(mul_c)(&b, &a, 121666);
+	MB_NAME(add_lazy)(&b, &bb, &b);
+	MB_NAME(mul)(z2, &a, &b);
+}
+
+/* Run MB_LANES ladders side by side, as projective_ladder() in
+ * c25519.c, and leave x(eq) in x and z.
+ */
+static MB_TARGET void MB_NAME(ladder)(uint64_t x[10][MB_LANES],
+				      uint64_t z[10][MB_LANES],
+				      const uint8_t *q, const uint8_t *e)
+{
+	uint64_t swap[MB_LANES] = {0};
+	uint64_t mask[MB_LANES];
+	struct MB_NAME(fe) x1;
+	struct MB_NAME(fe) x2;
+	struct MB_NAME(fe) z2;
+	struct MB_NAME(fe) x3;
+	struct MB_NAME(fe) z3;
+	int i;
+	int l;
+
+	for (l = 0; l < MB_LANES; l++)
+		mb_unpack(&x[0][l], MB_LANES, q + l * F25519_SIZE);
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++) {
+		x1.v[i] = MB_LOAD(x[i]);
+		x2.v[i] = MB_SET1(!i);
+		z2.v[i] = MB_SET1(0);
+		x3.v[i] = x1.v[i];
+		z3.v[i] = MB_SET1(!i);
+	}
+
+	for (i = 254; i >= 0; i--) {
+		MB_VEC m;
+
+		for (l = 0; l < MB_LANES; l++) {
+			const uint8_t *el = e + l * C25519_EXPONENT_SIZE;
+			const uint64_t bit = (el[i >> 3] >> (i & 7)) & 1;
+
+			mask[l] = -(swap[l] ^ bit);
+			swap[l] = bit;
+		}
+
+		m = MB_LOAD(mask);
+		MB_NAME(cswap)(&x2, &x3, m);
+		MB_NAME(cswap)(&z2, &z3, m);
+		MB_NAME(ladder_step)(&x2, &z2, &x3, &z3, &x1);
+	}
+
+	for (l = 0; l < MB_LANES; l++)
+		mask[l] = -swap[l];
+
+	MB_NAME(cswap)(&x2, &x3, MB_LOAD(mask));
+	MB_NAME(cswap)(&z2, &z3, MB_LOAD(mask));
+
+	MB_UNROLL
+	for (i = 0; i < 10; i++) {
+		MB_STORE(x[i], x2.v[i]);
+		MB_STORE(z[i], z2.v[i]);
+	}
+}
+
+static MB_TARGET void MB_NAME(smult)(uint8_t *result, const uint8_t *q,
+				     const uint8_t *e)
+{
+	uint64_t x[10][MB_LANES];
+	uint64_t z[10][MB_LANES];
+
+	MB_NAME(ladder)(x, z, q, e);
+	mb_finish(result, &x[0][0], &z[0][0], MB_LANES);
+}
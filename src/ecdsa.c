@@ -31,7 +31,7 @@ void ecdsa_pubkey(uint8_t *wx, uint8_t *wy, const uint8_t *secret)
 {
 	struct ed25519_pt p1;
 	uint8_t ex[F25519_SIZE], ey[F25519_SIZE];
-	ed25519_smult(&p1, &ed25519_base, secret);
+	ed25519_smult_base(&p1, secret);
 	ed25519_unproject(ex, ey, &p1);
 	morph25519_e2w(wx, wy, ex, ey);
 }
@@ -48,7 +48,7 @@ uint8_t ecdsa_sign(uint8_t *r, uint8_t *s, const uint8_t *d,
 	uint8_t ex[F25519_SIZE], ey[F25519_SIZE];
 	uint8_t wx[F25519_SIZE], wy[F25519_SIZE];
 	// 4. Calculate the curve point (x_1, y_1) = k * G.
-	ed25519_smult(&p1, &ed25519_base, k);
+	ed25519_smult_base(&p1, k);
 	ed25519_unproject(ex, ey, &p1);
 	morph25519_e2w(wx, wy, ex, ey);
 
@@ -86,8 +86,6 @@ uint8_t ecdsa_sign(uint8_t *r, uint8_t *s, const uint8_t *d,
 uint8_t ecdsa_verify(const uint8_t *x, const uint8_t *y,
 		      const uint8_t *e, const uint8_t *r, const uint8_t *s)
 {
-	struct ed25519_pt p1;
-	struct ed25519_pt p2;
 	struct ed25519_pt Q;
 	uint8_t w[FPRIME_SIZE], z[FPRIME_SIZE];
 	uint8_t u1[FPRIME_SIZE], u2[FPRIME_SIZE];
@@ -108,12 +106,9 @@ uint8_t ecdsa_verify(const uint8_t *x, const uint8_t *y,
 	fprime_mul(u2, r, w, n);
 
 	// 5. Calculate the curve point (x_1, y_1) = u_1 * G + u_2 * Q_A.
-	// tmp1 = u_1 * G
 	morph25519_w2e(ex, ey, x, y);
 	ed25519_project(&Q, ex, ey);
-	ed25519_smult(&p1, &ed25519_base, u1);
-	ed25519_smult(&p2, &Q, u2);
-	ed25519_add(&Q, &p1, &p2);
+	ed25519_double_scalarmult_vartime(&Q, u2, &Q, u1);
 	ed25519_unproject(ex, ey, &Q);
 	morph25519_e2w(wx, wy, ex, ey);
 
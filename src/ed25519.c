@@ -5,6 +5,7 @@
  */
 
 #include "ed25519.h"
+#include "ed25519_tab.h"
 
 /* Base point is (numbers wrapped):
  *
@@ -18,55 +19,78 @@
  * t is x*y.
  */
 const struct ed25519_pt ed25519_base = {
-	.x = {
+	.x = F25519_FE_INIT(
 		0x1a, 0xd5, 0x25, 0x8f, 0x60, 0x2d, 0x56, 0xc9,
 		0xb2, 0xa7, 0x25, 0x95, 0x60, 0xc7, 0x2c, 0x69,
 		0x5c, 0xdc, 0xd6, 0xfd, 0x31, 0xe2, 0xa4, 0xc0,
-		0xfe, 0x53, 0x6e, 0xcd, 0xd3, 0x36, 0x69, 0x21
-	},
-	.y = {
+		0xfe, 0x53, 0x6e, 0xcd, 0xd3, 0x36, 0x69, 0x21),
+	.y = F25519_FE_INIT(
 		0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
 		0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
 		0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
-		0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66
-	},
-	.t = {
+		0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66),
+	.t = F25519_FE_INIT(
 		0xa3, 0xdd, 0xb7, 0xa5, 0xb3, 0x8a, 0xde, 0x6d,
 		0xf5, 0x52, 0x51, 0x77, 0x80, 0x9f, 0xf0, 0x20,
 		0x7d, 0xe3, 0xab, 0x64, 0x8e, 0x4e, 0xea, 0x66,
-		0x65, 0x76, 0x8b, 0xd7, 0x0f, 0x5f, 0x87, 0x67
-	},
-	.z = {1, 0}
+		0x65, 0x76, 0x8b, 0xd7, 0x0f, 0x5f, 0x87, 0x67),
+	.z = {{1}}
 };
 
 const struct ed25519_pt ed25519_neutral = {
-	.x = {0},
-	.y = {1, 0},
-	.t = {0},
-	.z = {1, 0}
+	.x = {{0}},
+	.y = {{1}},
+	.t = {{0}},
+	.z = {{1}}
 };
 
 /* Conversion to and from projective coordinates */
 void ed25519_project(struct ed25519_pt *p,
 		     const uint8_t *x, const uint8_t *y)
 {
-	f25519_copy(p->x, x);
-	f25519_copy(p->y, y);
-	f25519_load(p->z, 1);
-	f25519_mul__distinct(p->t, x, y);
+	f25519_fe_frombytes(&p->x, x);
+	f25519_fe_frombytes(&p->y, y);
+	f25519_fe_load(&p->z, 1);
+	f25519_fe_mul(&p->t, &p->x, &p->y);
 }
 
 void ed25519_unproject(uint8_t *x, uint8_t *y,
 		       const struct ed25519_pt *p)
 {
-	uint8_t z1[F25519_SIZE];
+	struct f25519_fe z1;
+	struct f25519_fe a;
 
-	f25519_inv__distinct(z1, p->z);
-	f25519_mul__distinct(x, p->x, z1);
-	f25519_mul__distinct(y, p->y, z1);
+	f25519_fe_inv(&z1, &p->z);
+	f25519_fe_mul(&a, &p->x, &z1);
+	f25519_fe_tobytes(x, &a);
+	f25519_fe_mul(&a, &p->y, &z1);
+	f25519_fe_tobytes(y, &a);
+}
+
+void ed25519_unproject_batch(uint8_t *x, uint8_t *y,
+			     const struct ed25519_pt *p, size_t n,
+			     uint8_t *scratch)
+{
+	size_t i;
+
+	/* Invert all Z coordinates in place, using x for storage */
+	for (i = 0; i < n; i++)
+		f25519_fe_tobytes(x + i * F25519_SIZE, &p[i].z);
+
+	f25519_inv_batch(x, x, n, scratch);
+
+	for (i = 0; i < n; i++) {
+		uint8_t *xi = x + i * F25519_SIZE;
+		uint8_t *yi = y + i * F25519_SIZE;
+		struct f25519_fe z1;
+		struct f25519_fe a;
 
-	f25519_normalize(x);
-	f25519_normalize(y);
+		f25519_fe_frombytes(&z1, xi);
+		f25519_fe_mul(&a, &p[i].x, &z1);
+		f25519_fe_tobytes(xi, &a);
+		f25519_fe_mul(&a, &p[i].y, &z1);
+		f25519_fe_tobytes(yi, &a);
+	}
 }
 
 /* Compress/uncompress points. We compress points by storing the x
@@ -84,12 +108,11 @@ void ed25519_unproject(uint8_t *x, uint8_t *y,
  *         42113879843219016388785533085940283555
  */
 
-static const uint8_t ed25519_d[F25519_SIZE] = {
+static const struct f25519_fe ed25519_d = F25519_FE_INIT(
 	0xa3, 0x78, 0x59, 0x13, 0xca, 0x4d, 0xeb, 0x75,
 	0xab, 0xd8, 0x41, 0x41, 0x4d, 0x0a, 0x70, 0x00,
 	0x98, 0xe8, 0x79, 0x77, 0x79, 0x40, 0xc7, 0x8c,
-	0x73, 0xfe, 0x6f, 0x2b, 0xee, 0x6c, 0x03, 0x52
-};
+	0x73, 0xfe, 0x6f, 0x2b, 0xee, 0x6c, 0x03, 0x52);
 
 void ed25519_pack(uint8_t *c, const uint8_t *x, const uint8_t *y)
 {
@@ -105,56 +128,87 @@ void ed25519_pack(uint8_t *c, const uint8_t *x, const uint8_t *y)
 	c[31] |= parity;
 }
 
+void ed25519_pack_batch(uint8_t *c, const struct ed25519_pt *p, size_t n,
+			uint8_t *scratch)
+{
+	size_t i;
+
+	/* Invert all Z coordinates in place, using c for storage */
+	for (i = 0; i < n; i++)
+		f25519_fe_tobytes(c + i * F25519_SIZE, &p[i].z);
+
+	f25519_inv_batch(c, c, n, scratch);
+
+	for (i = 0; i < n; i++) {
+		uint8_t *ci = c + i * F25519_SIZE;
+		uint8_t x[F25519_SIZE];
+		struct f25519_fe z1;
+		struct f25519_fe a;
+
+		f25519_fe_frombytes(&z1, ci);
+		f25519_fe_mul(&a, &p[i].x, &z1);
+		f25519_fe_tobytes(x, &a);
+		f25519_fe_mul(&a, &p[i].y, &z1);
+		f25519_fe_tobytes(ci, &a);
+		ci[31] |= (x[0] & 1) << 7;
+	}
+}
+
 uint8_t ed25519_try_unpack(uint8_t *x, uint8_t *y, const uint8_t *comp)
 {
 	const int parity = comp[31] >> 7;
-	uint8_t a[F25519_SIZE];
-	uint8_t b[F25519_SIZE];
-	uint8_t c[F25519_SIZE];
+	uint8_t buf[F25519_SIZE];
+	struct f25519_fe a;
+	struct f25519_fe b;
+	struct f25519_fe c;
+	struct f25519_fe yf;
+	uint8_t ok;
 
 	/* Unpack y */
 	f25519_copy(y, comp);
 	y[31] &= 127;
+	f25519_fe_frombytes(&yf, y);
+	f25519_fe_tobytes(y, &yf);
 
 	/* Compute c = y^2 */
-	f25519_mul__distinct(c, y, y);
+	f25519_fe_sqr(&c, &yf);
 
-	/* Compute b = (1+dy^2)^-1 */
-	f25519_mul__distinct(b, c, ed25519_d);
-	f25519_add(a, b, f25519_one);
-	f25519_inv__distinct(b, a);
+	/* Compute b = 1+dy^2 */
+	f25519_fe_mul(&b, &c, &ed25519_d);
+	f25519_fe_add(&b, &b, &f25519_fe_one);
 
 	/* Compute a = y^2-1 */
-	f25519_sub(a, c, f25519_one);
-
-	/* Compute c = a*b = (y^2-1)/(1-dy^2) */
-	f25519_mul__distinct(c, a, b);
+	f25519_fe_sub(&a, &c, &f25519_fe_one);
 
-	/* Compute a, b = +/-sqrt(c), if c is square */
-	f25519_sqrt(a, c);
-	f25519_neg(b, a);
+	/* Compute a, b = +/-sqrt(a/b), if a/b is square */
+	ok = f25519_fe_sqrt_ratio(&a, &a, &b);
+	f25519_fe_neg(&b, &a);
 
 	/* Select one of them, based on the compressed parity bit */
-	f25519_select(x, a, b, (a[0] ^ parity) & 1);
+	f25519_fe_tobytes(buf, &a);
+	f25519_fe_select(&a, &a, &b, (buf[0] ^ parity) & 1);
+	f25519_fe_tobytes(x, &a);
 
-	/* Verify that x^2 = c */
-	f25519_mul__distinct(a, x, x);
-	f25519_normalize(a);
-	f25519_normalize(c);
-
-	return f25519_eq(a, c);
+	return ok;
 }
 
 /* k = 2d */
-static const uint8_t ed25519_k[F25519_SIZE] = {
+static const struct f25519_fe ed25519_k = F25519_FE_INIT(
 	0x59, 0xf1, 0xb2, 0x26, 0x94, 0x9b, 0xd6, 0xeb,
 	0x56, 0xb1, 0x83, 0x82, 0x9a, 0x14, 0xe0, 0x00,
 	0x30, 0xd1, 0xf3, 0xee, 0xf2, 0x80, 0x8e, 0x19,
-	0xe7, 0xfc, 0xdf, 0x56, 0xdc, 0xd9, 0x06, 0x24
-};
+	0xe7, 0xfc, 0xdf, 0x56, 0xdc, 0xd9, 0x06, 0x24);
 
-void ed25519_add(struct ed25519_pt *r,
-		 const struct ed25519_pt *p1, const struct ed25519_pt *p2)
+void ed25519_cache(struct ed25519_cached_pt *c, const struct ed25519_pt *p)
+{
+	f25519_fe_add_lazy(&c->yplusx, &p->y, &p->x);
+	f25519_fe_sub_lazy(&c->yminusx, &p->y, &p->x);
+	f25519_fe_copy(&c->z, &p->z);
+	f25519_fe_mul(&c->t2d, &p->t, &ed25519_k);
+}
+
+void ed25519_add_cached(struct ed25519_pt *r, const struct ed25519_pt *p1,
+			const struct ed25519_cached_pt *p2)
 {
 	/* Explicit formulas database: add-2008-hwcd-3
 	 *
@@ -175,60 +229,72 @@ void ed25519_add(struct ed25519_pt *r,
 	 * compute Y3 = G H
 	 * compute T3 = E H
 	 * compute Z3 = F G
+	 *
+	 * Y2-X2, Y2+X2 and k T2 are precomputed in the cached point.
 	 */
-	uint8_t a[F25519_SIZE];
-	uint8_t b[F25519_SIZE];
-	uint8_t c[F25519_SIZE];
-	uint8_t d[F25519_SIZE];
-	uint8_t e[F25519_SIZE];
-	uint8_t f[F25519_SIZE];
-	uint8_t g[F25519_SIZE];
-	uint8_t h[F25519_SIZE];
+	struct f25519_fe a;
+	struct f25519_fe b;
+	struct f25519_fe c;
+	struct f25519_fe d;
+	struct f25519_fe e;
+	struct f25519_fe f;
+	struct f25519_fe g;
+	struct f25519_fe h;
 
 	/* A = (Y1-X1)(Y2-X2) */
-	f25519_sub(c, p1->y, p1->x);
-	f25519_sub(d, p2->y, p2->x);
-	f25519_mul__distinct(a, c, d);
+	f25519_fe_sub_lazy(&c, &p1->y, &p1->x);
+	f25519_fe_mul(&a, &c, &p2->yminusx);
 
 	/* B = (Y1+X1)(Y2+X2) */
-	f25519_add(c, p1->y, p1->x);
-	f25519_add(d, p2->y, p2->x);
-	f25519_mul__distinct(b, c, d);
+	f25519_fe_add_lazy(&c, &p1->y, &p1->x);
+	f25519_fe_mul(&b, &c, &p2->yplusx);
 
 	/* C = T1 k T2 */
-	f25519_mul__distinct(d, p1->t, p2->t);
-	f25519_mul__distinct(c, d, ed25519_k);
+	f25519_fe_mul(&c, &p1->t, &p2->t2d);
 
-	/* D = Z1 2 Z2 */
-	f25519_mul__distinct(d, p1->z, p2->z);
-	f25519_add(d, d, d);
+	/* D = Z1 2 Z2 (carried, since it feeds F and G below) */
+	f25519_fe_mul(&d, &p1->z, &p2->z);
+	f25519_fe_add(&d, &d, &d);
 
 	/* E = B - A */
-	f25519_sub(e, b, a);
+	f25519_fe_sub_lazy(&e, &b, &a);
 
 	/* F = D - C */
-	f25519_sub(f, d, c);
+	f25519_fe_sub_lazy(&f, &d, &c);
 
 	/* G = D + C */
-	f25519_add(g, d, c);
+	f25519_fe_add_lazy(&g, &d, &c);
 
 	/* H = B + A */
-	f25519_add(h, b, a);
+	f25519_fe_add_lazy(&h, &b, &a);
 
 	/* X3 = E F */
-	f25519_mul__distinct(r->x, e, f);
+	f25519_fe_mul(&r->x, &e, &f);
 
 	/* Y3 = G H */
-	f25519_mul__distinct(r->y, g, h);
+	f25519_fe_mul(&r->y, &g, &h);
 
 	/* T3 = E H */
-	f25519_mul__distinct(r->t, e, h);
+	f25519_fe_mul(&r->t, &e, &h);
 
 	/* Z3 = F G */
-	f25519_mul__distinct(r->z, f, g);
+	f25519_fe_mul(&r->z, &f, &g);
 }
 
-void ed25519_double(struct ed25519_pt *r, const struct ed25519_pt *p)
+void ed25519_add(struct ed25519_pt *r,
+		 const struct ed25519_pt *p1, const struct ed25519_pt *p2)
+{
+	struct ed25519_cached_pt c;
+
+	ed25519_cache(&c, p2);
+	ed25519_add_cached(r, p1, &c);
+}
+
+/* Doubling doesn't read T, so a variable-time caller that will double
+ * the result again can skip computing it, by passing need_t = 0.
+ */
+static void double_pt(struct ed25519_pt *r, const struct ed25519_pt *p,
+		      int need_t)
 {
 	/* Explicit formulas database: dbl-2008-hwcd
 	 *
@@ -247,60 +313,67 @@ void ed25519_double(struct ed25519_pt *r, const struct ed25519_pt *p)
 	 * compute T3 = E H
 	 * compute Z3 = F G
 	 */
-	uint8_t a[F25519_SIZE];
-	uint8_t b[F25519_SIZE];
-	uint8_t c[F25519_SIZE];
-	uint8_t e[F25519_SIZE];
-	uint8_t f[F25519_SIZE];
-	uint8_t g[F25519_SIZE];
-	uint8_t h[F25519_SIZE];
+	struct f25519_fe a;
+	struct f25519_fe b;
+	struct f25519_fe c;
+	struct f25519_fe e;
+	struct f25519_fe f;
+	struct f25519_fe g;
+	struct f25519_fe h;
 
 	/* A = X1^2 */
-	f25519_mul__distinct(a, p->x, p->x);
+	f25519_fe_sqr(&a, &p->x);
 
 	/* B = Y1^2 */
-	f25519_mul__distinct(b, p->y, p->y);
+	f25519_fe_sqr(&b, &p->y);
 
 	/* C = 2 Z1^2 */
-	f25519_mul__distinct(c, p->z, p->z);
-	f25519_add(c, c, c);
+	f25519_fe_sqr(&c, &p->z);
+	f25519_fe_add(&c, &c, &c);
 
 	/* D = a A (alter sign) */
-	/* E = (X1+Y1)^2-A-B */
-	f25519_add(f, p->x, p->y);
-	f25519_mul__distinct(e, f, f);
-	f25519_sub(e, e, a);
-	f25519_sub(e, e, b);
+	/* E = (X1+Y1)^2-A-B = (X1+Y1)^2-(A+B) */
+	f25519_fe_add(&h, &a, &b);
+	f25519_fe_add_lazy(&f, &p->x, &p->y);
+	f25519_fe_sqr(&e, &f);
+	f25519_fe_sub_lazy(&e, &e, &h);
 
 	/* G = D + B */
-	f25519_sub(g, b, a);
+	f25519_fe_sub(&g, &b, &a);
 
 	/* F = G - C */
-	f25519_sub(f, g, c);
+	f25519_fe_sub_lazy(&f, &g, &c);
 
-	/* H = D - B */
-	f25519_neg(h, b);
-	f25519_sub(h, h, a);
+	/* H = D - B = -(A+B) */
+	f25519_fe_sub_lazy(&h, &f25519_fe_zero, &h);
 
 	/* X3 = E F */
-	f25519_mul__distinct(r->x, e, f);
+	f25519_fe_mul(&r->x, &e, &f);
 
 	/* Y3 = G H */
-	f25519_mul__distinct(r->y, g, h);
+	f25519_fe_mul(&r->y, &g, &h);
 
 	/* T3 = E H */
-	f25519_mul__distinct(r->t, e, h);
+	if (need_t)
+		f25519_fe_mul(&r->t, &e, &h);
 
 	/* Z3 = F G */
-	f25519_mul__distinct(r->z, f, g);
+	f25519_fe_mul(&r->z, &f, &g);
+}
+
+void ed25519_double(struct ed25519_pt *r, const struct ed25519_pt *p)
+{
+	double_pt(r, p, 1);
 }
 
 void ed25519_smult(struct ed25519_pt *r_out, const struct ed25519_pt *p,
 		   const uint8_t *e)
 {
+	struct ed25519_cached_pt pc;
 	struct ed25519_pt r;
 	int i;
 
+	ed25519_cache(&pc, p);
 	ed25519_copy(&r, &ed25519_neutral);
 
 	for (i = 255; i >= 0; i--) {
@@ -308,13 +381,894 @@ void ed25519_smult(struct ed25519_pt *r_out, const struct ed25519_pt *p,
 		struct ed25519_pt s;
 
 		ed25519_double(&r, &r);
-		ed25519_add(&s, &r, p);
+		ed25519_add_cached(&s, &r, &pc);
+
+		f25519_fe_select(&r.x, &r.x, &s.x, bit);
+		f25519_fe_select(&r.y, &r.y, &s.y, bit);
+		f25519_fe_select(&r.z, &r.z, &s.z, bit);
+		f25519_fe_select(&r.t, &r.t, &s.t, bit);
+	}
+
+	ed25519_copy(r_out, &r);
+}
+
+/* Recode e into width-w NAF: naf[i] is zero or odd with magnitude below
+ * 2^(w-1), any nonzero digit is followed by at least w-1 zeros, and e is
+ * the sum of naf[i] * 2^i. Returns the index of the highest nonzero
+ * digit, or -1 if e = 0. Not constant-time.
+ */
+#define WNAF_LEN  (ED25519_EXPONENT_SIZE * 8 + 1)
+
+static uint8_t exp_bit(const uint8_t *e, int i)
+{
+	if (i >= ED25519_EXPONENT_SIZE * 8)
+		return 0;
+
+	return (e[i >> 3] >> (i & 7)) & 1;
+}
+
+static int wnaf(int8_t *naf, const uint8_t *e, int w)
+{
+	int carry = 0;
+	int top = -1;
+	int i = 0;
+
+	memset(naf, 0, WNAF_LEN);
+
+	while (i < WNAF_LEN) {
+		int now = w;
+		int word = 0;
+		int j;
+
+		if (exp_bit(e, i) == carry) {
+			i++;
+			continue;
+		}
+
+		if (now > WNAF_LEN - i)
+			now = WNAF_LEN - i;
+
+		for (j = 0; j < now; j++)
+			word |= exp_bit(e, i + j) << j;
+
+		/* word is odd, so this leaves it in (-2^(w-1), 2^(w-1)) */
+		word += carry;
+		carry = (word >> (w - 1)) & 1;
+		word -= carry << w;
+
+		naf[i] = word;
+		top = i;
+		i += now;
+	}
+
+	return top;
+}
+
+#if ED25519_SMALL_STACK
+/* Left-to-right sliding windows, found as the multiply goes so that no
+ * digit array is needed. Working down from bit i, find the next window
+ * of at most w bits which starts and ends with a one. Returns its odd
+ * value, and sets *at to the position of its lowest bit, or to -1 if
+ * the rest of e is zero. Not constant-time.
+ */
+#define SLIDE_WIDTH  3
+
+static int next_window(const uint8_t *e, int i, int w, int *at)
+{
+	int v = 0;
+	int j;
+
+	while (i >= 0 && !exp_bit(e, i))
+		i--;
+
+	if (i < 0) {
+		*at = -1;
+		return 0;
+	}
+
+	for (j = 0; j < w && j <= i; j++)
+		v = (v << 1) | exp_bit(e, i - j);
+
+	*at = i - j + 1;
+
+	while (!(v & 1)) {
+		v >>= 1;
+		(*at)++;
+	}
+
+	return v;
+}
+#endif
+
+/* tab[i] = (2i + 1) p, for 0 <= i < n, in cached form. n >= 2. q is
+ * used as workspace.
+ */
+static void odd_multiples(struct ed25519_cached_pt *tab,
+			  struct ed25519_pt *q,
+			  const struct ed25519_pt *p, int n)
+{
+	int i;
+
+	/* 2P is kept in the last entry until that is filled */
+	ed25519_cache(&tab[0], p);
+	double_pt(q, p, 1);
+	ed25519_cache(&tab[n - 1], q);
+	ed25519_copy(q, p);
+
+	for (i = 1; i < n; i++) {
+		ed25519_add_cached(q, q, &tab[n - 1]);
+		ed25519_cache(&tab[i], q);
+	}
+}
+
+/* Add p to r, or subtract it if neg is set */
+static void add_signed(struct ed25519_pt *r, const struct ed25519_cached_pt *p,
+		       int neg)
+{
+	struct ed25519_cached_pt c;
+
+	if (!neg) {
+		ed25519_add_cached(r, r, p);
+		return;
+	}
+
+	/* -(x, y) = (-x, y), which swaps y+x with y-x */
+	f25519_fe_copy(&c.yplusx, &p->yminusx);
+	f25519_fe_copy(&c.yminusx, &p->yplusx);
+	f25519_fe_copy(&c.z, &p->z);
+	f25519_fe_neg(&c.t2d, &p->t2d);
+	ed25519_add_cached(r, r, &c);
+}
+
+#if ED25519_SMALL_STACK
+void ed25519_smult_vartime(struct ed25519_pt *r_out,
+			   const struct ed25519_pt *p, const uint8_t *e)
+{
+	struct ed25519_cached_pt tab[1 << (SLIDE_WIDTH - 1)];
+	struct ed25519_pt r;
+	int at;
+	int d = next_window(e, ED25519_EXPONENT_SIZE * 8 - 1, SLIDE_WIDTH,
+			    &at);
+	const int top = at;
+	int i;
+
+	odd_multiples(tab, &r, p, 1 << (SLIDE_WIDTH - 1));
+	ed25519_copy(&r, &ed25519_neutral);
+
+	for (i = top; i >= 0; i--) {
+		if (i < top)
+			double_pt(&r, &r, i == at || !i);
+
+		if (i == at) {
+			ed25519_add_cached(&r, &r, &tab[d >> 1]);
+			d = next_window(e, i - 1, SLIDE_WIDTH, &at);
+		}
+	}
+
+	ed25519_copy(r_out, &r);
+}
+#else
+void ed25519_smult_vartime(struct ed25519_pt *r_out,
+			   const struct ed25519_pt *p, const uint8_t *e)
+{
+	struct ed25519_cached_pt tab[8];
+	struct ed25519_pt r;
+	int8_t naf[WNAF_LEN];
+	int top = wnaf(naf, e, 5);
+	int i;
+
+	odd_multiples(tab, &r, p, 8);
+	ed25519_copy(&r, &ed25519_neutral);
+
+	for (i = top; i >= 0; i--) {
+		const int8_t d = naf[i];
+
+		if (i < top)
+			double_pt(&r, &r, d || !i);
 
-		f25519_select(r.x, r.x, s.x, bit);
-		f25519_select(r.y, r.y, s.y, bit);
-		f25519_select(r.z, r.z, s.z, bit);
-		f25519_select(r.t, r.t, s.t, bit);
+		if (d > 0)
+			add_signed(&r, &tab[d >> 1], 0);
+		else if (d < 0)
+			add_signed(&r, &tab[(-d) >> 1], 1);
 	}
 
 	ed25519_copy(r_out, &r);
 }
+#endif
+
+/* Two independent additions, as ed25519_add_cached(), with the field
+ * operations of each issued alternately. Each argument points to two
+ * points.
+ */
+static void add2(struct ed25519_pt *r, const struct ed25519_pt *p1,
+		 const struct ed25519_cached_pt *p2)
+{
+	struct f25519_fe a[2];
+	struct f25519_fe b[2];
+	struct f25519_fe c[2];
+	struct f25519_fe d[2];
+	struct f25519_fe e[2];
+	struct f25519_fe f[2];
+	struct f25519_fe g[2];
+	struct f25519_fe h[2];
+
+	f25519_fe_sub_lazy(&c[0], &p1[0].y, &p1[0].x);
+	f25519_fe_sub_lazy(&c[1], &p1[1].y, &p1[1].x);
+	f25519_fe_mul(&a[0], &c[0], &p2[0].yminusx);
+	f25519_fe_mul(&a[1], &c[1], &p2[1].yminusx);
+
+	f25519_fe_add_lazy(&c[0], &p1[0].y, &p1[0].x);
+	f25519_fe_add_lazy(&c[1], &p1[1].y, &p1[1].x);
+	f25519_fe_mul(&b[0], &c[0], &p2[0].yplusx);
+	f25519_fe_mul(&b[1], &c[1], &p2[1].yplusx);
+
+	f25519_fe_mul(&c[0], &p1[0].t, &p2[0].t2d);
+	f25519_fe_mul(&c[1], &p1[1].t, &p2[1].t2d);
+
+	f25519_fe_mul(&d[0], &p1[0].z, &p2[0].z);
+	f25519_fe_mul(&d[1], &p1[1].z, &p2[1].z);
+	f25519_fe_add(&d[0], &d[0], &d[0]);
+	f25519_fe_add(&d[1], &d[1], &d[1]);
+
+	f25519_fe_sub_lazy(&e[0], &b[0], &a[0]);
+	f25519_fe_sub_lazy(&e[1], &b[1], &a[1]);
+	f25519_fe_sub_lazy(&f[0], &d[0], &c[0]);
+	f25519_fe_sub_lazy(&f[1], &d[1], &c[1]);
+	f25519_fe_add_lazy(&g[0], &d[0], &c[0]);
+	f25519_fe_add_lazy(&g[1], &d[1], &c[1]);
+	f25519_fe_add_lazy(&h[0], &b[0], &a[0]);
+	f25519_fe_add_lazy(&h[1], &b[1], &a[1]);
+
+	f25519_fe_mul(&r[0].x, &e[0], &f[0]);
+	f25519_fe_mul(&r[1].x, &e[1], &f[1]);
+	f25519_fe_mul(&r[0].y, &g[0], &h[0]);
+	f25519_fe_mul(&r[1].y, &g[1], &h[1]);
+	f25519_fe_mul(&r[0].t, &e[0], &h[0]);
+	f25519_fe_mul(&r[1].t, &e[1], &h[1]);
+	f25519_fe_mul(&r[0].z, &f[0], &g[0]);
+	f25519_fe_mul(&r[1].z, &f[1], &g[1]);
+}
+
+/* Two independent doublings, as ed25519_double() */
+static void double2(struct ed25519_pt *r, const struct ed25519_pt *p)
+{
+	struct f25519_fe a[2];
+	struct f25519_fe b[2];
+	struct f25519_fe c[2];
+	struct f25519_fe e[2];
+	struct f25519_fe f[2];
+	struct f25519_fe g[2];
+	struct f25519_fe h[2];
+
+	f25519_fe_sqr(&a[0], &p[0].x);
+	f25519_fe_sqr(&a[1], &p[1].x);
+	f25519_fe_sqr(&b[0], &p[0].y);
+	f25519_fe_sqr(&b[1], &p[1].y);
+	f25519_fe_sqr(&c[0], &p[0].z);
+	f25519_fe_sqr(&c[1], &p[1].z);
+	f25519_fe_add(&c[0], &c[0], &c[0]);
+	f25519_fe_add(&c[1], &c[1], &c[1]);
+
+	f25519_fe_add(&h[0], &a[0], &b[0]);
+	f25519_fe_add(&h[1], &a[1], &b[1]);
+	f25519_fe_add_lazy(&f[0], &p[0].x, &p[0].y);
+	f25519_fe_add_lazy(&f[1], &p[1].x, &p[1].y);
+	f25519_fe_sqr(&e[0], &f[0]);
+	f25519_fe_sqr(&e[1], &f[1]);
+	f25519_fe_sub_lazy(&e[0], &e[0], &h[0]);
+	f25519_fe_sub_lazy(&e[1], &e[1], &h[1]);
+
+	f25519_fe_sub(&g[0], &b[0], &a[0]);
+	f25519_fe_sub(&g[1], &b[1], &a[1]);
+	f25519_fe_sub_lazy(&f[0], &g[0], &c[0]);
+	f25519_fe_sub_lazy(&f[1], &g[1], &c[1]);
+	f25519_fe_sub_lazy(&h[0], &f25519_fe_zero, &h[0]);
+	f25519_fe_sub_lazy(&h[1], &f25519_fe_zero, &h[1]);
+
+	f25519_fe_mul(&r[0].x, &e[0], &f[0]);
+	f25519_fe_mul(&r[1].x, &e[1], &f[1]);
+	f25519_fe_mul(&r[0].y, &g[0], &h[0]);
+	f25519_fe_mul(&r[1].y, &g[1], &h[1]);
+	f25519_fe_mul(&r[0].t, &e[0], &h[0]);
+	f25519_fe_mul(&r[1].t, &e[1], &h[1]);
+	f25519_fe_mul(&r[0].z, &f[0], &g[0]);
+	f25519_fe_mul(&r[1].z, &f[1], &g[1]);
+}
+
+void ed25519_smult2(struct ed25519_pt *r_out, const struct ed25519_pt *p,
+		    const uint8_t *e)
+{
+	struct ed25519_cached_pt pc[2];
+	struct ed25519_pt r[2];
+	int i;
+	int k;
+
+	ed25519_cache(&pc[0], &p[0]);
+	ed25519_cache(&pc[1], &p[1]);
+	ed25519_copy(&r[0], &ed25519_neutral);
+	ed25519_copy(&r[1], &ed25519_neutral);
+
+	for (i = 255; i >= 0; i--) {
+		struct ed25519_pt s[2];
+
+		double2(r, r);
+		add2(s, r, pc);
+
+		for (k = 0; k < 2; k++) {
+			const uint8_t *ek = e + k * ED25519_EXPONENT_SIZE;
+			const uint8_t bit = (ek[i >> 3] >> (i & 7)) & 1;
+
+			f25519_fe_select(&r[k].x, &r[k].x, &s[k].x, bit);
+			f25519_fe_select(&r[k].y, &r[k].y, &s[k].y, bit);
+			f25519_fe_select(&r[k].z, &r[k].z, &s[k].z, bit);
+			f25519_fe_select(&r[k].t, &r[k].t, &s[k].t, bit);
+		}
+	}
+
+	ed25519_copy(&r_out[0], &r[0]);
+	ed25519_copy(&r_out[1], &r[1]);
+}
+
+void ed25519_add_mixed(struct ed25519_pt *r, const struct ed25519_pt *p1,
+		       const struct ed25519_niels *p2)
+{
+	/* Explicit formulas database: madd-2008-hwcd-3
+	 *
+	 * As for add-2008-hwcd-3, with Z2 = 1 and the sums, differences
+	 * and k T2 of the second point precomputed.
+	 */
+	struct f25519_fe a;
+	struct f25519_fe b;
+	struct f25519_fe c;
+	struct f25519_fe d;
+	struct f25519_fe e;
+	struct f25519_fe f;
+	struct f25519_fe g;
+	struct f25519_fe h;
+
+	/* A = (Y1-X1)(Y2-X2) */
+	f25519_fe_sub_lazy(&c, &p1->y, &p1->x);
+	f25519_fe_mul(&a, &c, &p2->yminusx);
+
+	/* B = (Y1+X1)(Y2+X2) */
+	f25519_fe_add_lazy(&c, &p1->y, &p1->x);
+	f25519_fe_mul(&b, &c, &p2->yplusx);
+
+	/* C = T1 k T2 */
+	f25519_fe_mul(&c, &p1->t, &p2->xy2d);
+
+	/* D = 2 Z1 */
+	f25519_fe_add(&d, &p1->z, &p1->z);
+
+	/* E = B - A, F = D - C, G = D + C, H = B + A */
+	f25519_fe_sub_lazy(&e, &b, &a);
+	f25519_fe_sub_lazy(&f, &d, &c);
+	f25519_fe_add_lazy(&g, &d, &c);
+	f25519_fe_add_lazy(&h, &b, &a);
+
+	f25519_fe_mul(&r->x, &e, &f);
+	f25519_fe_mul(&r->y, &g, &h);
+	f25519_fe_mul(&r->t, &e, &h);
+	f25519_fe_mul(&r->z, &f, &g);
+}
+
+/* Negate r if neg is 1. -(x, y) = (-x, y), which swaps y+x with y-x. */
+static void cneg_niels(struct ed25519_niels *r, uint8_t neg)
+{
+	struct f25519_fe t;
+
+	f25519_fe_cswap(&r->yplusx, &r->yminusx, neg);
+	f25519_fe_neg(&t, &r->xy2d);
+	f25519_fe_select(&r->xy2d, &r->xy2d, &t, neg);
+}
+
+/* Set r = d * row[0], for -8 <= d <= 8, without secret-dependent
+ * memory access. d = 0 gives the neutral point (1, 1, 0).
+ */
+static void select_niels(struct ed25519_niels *r,
+			 const struct ed25519_niels *row, int8_t d)
+{
+	const uint8_t neg = ((uint8_t)d) >> 7;
+	const uint8_t mag = (d ^ -neg) + neg;
+	int i;
+
+	f25519_fe_load(&r->yplusx, 1);
+	f25519_fe_load(&r->yminusx, 1);
+	f25519_fe_load(&r->xy2d, 0);
+
+	for (i = 0; i < 8; i++) {
+		const uint8_t eq = ((uint8_t)((mag ^ (i + 1)) - 1)) >> 7;
+
+		f25519_fe_select(&r->yplusx, &r->yplusx, &row[i].yplusx, eq);
+		f25519_fe_select(&r->yminusx, &r->yminusx,
+				 &row[i].yminusx, eq);
+		f25519_fe_select(&r->xy2d, &r->xy2d, &row[i].xy2d, eq);
+	}
+
+	cneg_niels(r, neg);
+}
+
+/* Recode e into signed radix-16 digits. All but the top digit are in
+ * [-8, 8), and the top one is in [0, 16]. If e < 2^255, the top digit
+ * is at most 8.
+ */
+static void recode16(int8_t *digit, const uint8_t *e)
+{
+	int8_t carry = 0;
+	int i;
+
+	for (i = 0; i < 32; i++) {
+		digit[2 * i] = e[i] & 15;
+		digit[2 * i + 1] = e[i] >> 4;
+	}
+
+	for (i = 0; i < 63; i++) {
+		digit[i] += carry;
+		carry = (digit[i] + 8) >> 4;
+		digit[i] -= carry << 4;
+	}
+
+	digit[63] += carry;
+}
+
+/* Sum of digit[i] * 16^i * P, given the table for P */
+static void smult_niels(struct ed25519_pt *r,
+			const struct ed25519_niels *tab,
+			const int8_t *digit)
+{
+	struct ed25519_niels s;
+	int i;
+
+	ed25519_copy(r, &ed25519_neutral);
+
+	/* Odd digits, shifted up by four doublings */
+	for (i = 1; i < 64; i += 2) {
+		select_niels(&s, tab + (i >> 1) * 8, digit[i]);
+		ed25519_add_mixed(r, r, &s);
+	}
+
+	for (i = 0; i < 4; i++)
+		ed25519_double(r, r);
+
+	/* Even digits */
+	for (i = 0; i < 64; i += 2) {
+		select_niels(&s, tab + (i >> 1) * 8, digit[i]);
+		ed25519_add_mixed(r, r, &s);
+	}
+}
+
+#if ED25519_COMB == 0
+
+void ed25519_smult_base(struct ed25519_pt *r_out, const uint8_t *e)
+{
+	struct ed25519_niels s;
+	struct ed25519_pt r;
+	int8_t digit[64];
+	int8_t carry;
+
+	/* Split a top digit of 8 or more into a negative digit and a
+	 * carry, which is a multiple of 2^256.
+	 */
+	recode16(digit, e);
+	carry = (digit[63] + 8) >> 4;
+	digit[63] -= carry << 4;
+
+	smult_niels(&r, ed25519_base_tab[0], digit);
+
+	f25519_fe_select(&s.yplusx, &f25519_fe_one,
+			 &ed25519_base_tab_carry.yplusx, carry);
+	f25519_fe_select(&s.yminusx, &f25519_fe_one,
+			 &ed25519_base_tab_carry.yminusx, carry);
+	f25519_fe_select(&s.xy2d, &f25519_fe_zero,
+			 &ed25519_base_tab_carry.xy2d, carry);
+	ed25519_add_mixed(&r, &r, &s);
+
+	ed25519_copy(r_out, &r);
+}
+
+#else
+
+/* Order of the base point, l = 2^252 + 27742317777372353535851937790883648493 */
+static const uint8_t ed25519_order[ED25519_EXPONENT_SIZE] = {
+	0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+	0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+/* The comb reads an odd k (e, or e + l) as n = TEETH * COMBS * SPACING
+ * digits of +/-1:
+ *
+ *     k = sum of (2 s[i] - 1) 2^i, for 0 <= i < n
+ *
+ * where s = (k + 2^n - 1) / 2 = (k >> 1) + 2^(n - 1), and s[i] is its
+ * bit i. Since k < 2^257 <= 2^(n - 1), s[i] is bit i + 1 of k, except
+ * that s[n - 1] = 1.
+ */
+static uint8_t comb_bit(const uint8_t *k, int i)
+{
+	const int n = ED25519_COMB_TEETH * ED25519_COMB_COMBS *
+		ED25519_COMB_SPACING;
+
+	if (i == n - 1)
+		return 1;
+
+	i++;
+	if (i > 256)
+		return 0;
+
+	return (k[i >> 3] >> (i & 7)) & 1;
+}
+
+/* Select the table entry for the teeth of comb j at column c, without
+ * secret-dependent memory access.
+ */
+static void select_comb(struct ed25519_niels *r, const uint8_t *k,
+			int j, int c)
+{
+	const struct ed25519_niels *row = ed25519_comb_tab[j];
+	const int pos = c + ED25519_COMB_SPACING * ED25519_COMB_TEETH * j;
+	const uint8_t b0 = comb_bit(k, pos);
+	uint8_t idx = 0;
+	int i;
+
+	/* Tooth 0 has the sign of the whole sum, and the others are
+	 * stored relative to it.
+	 */
+	for (i = 1; i < ED25519_COMB_TEETH; i++)
+		idx |= (comb_bit(k, pos + ED25519_COMB_SPACING * i) ^ b0 ^ 1)
+			<< (i - 1);
+
+	memcpy(r, &row[0], sizeof(*r));
+
+	for (i = 1; i < (1 << (ED25519_COMB_TEETH - 1)); i++) {
+		const uint8_t eq = ((uint8_t)((idx ^ i) - 1)) >> 7;
+
+		f25519_fe_select(&r->yplusx, &r->yplusx, &row[i].yplusx, eq);
+		f25519_fe_select(&r->yminusx, &r->yminusx,
+				 &row[i].yminusx, eq);
+		f25519_fe_select(&r->xy2d, &r->xy2d, &row[i].xy2d, eq);
+	}
+
+	cneg_niels(r, b0 ^ 1);
+}
+
+void ed25519_smult_base(struct ed25519_pt *r_out, const uint8_t *e)
+{
+	const uint8_t even = (e[0] & 1) - 1;
+	struct ed25519_niels s;
+	struct ed25519_pt r;
+	uint8_t k[ED25519_EXPONENT_SIZE + 1];
+	uint16_t c = 0;
+	int i;
+	int j;
+
+	/* The signed digits can only express odd numbers, so add l to an
+	 * even e. This leaves eB unchanged.
+	 */
+	for (i = 0; i < ED25519_EXPONENT_SIZE; i++) {
+		c += e[i] + (ed25519_order[i] & even);
+		k[i] = c;
+		c >>= 8;
+	}
+
+	k[i] = c;
+
+	ed25519_copy(&r, &ed25519_neutral);
+
+	for (i = ED25519_COMB_SPACING - 1; i >= 0; i--) {
+		if (i < ED25519_COMB_SPACING - 1)
+			ed25519_double(&r, &r);
+
+		for (j = 0; j < ED25519_COMB_COMBS; j++) {
+			select_comb(&s, k, j, i);
+			ed25519_add_mixed(&r, &r, &s);
+		}
+	}
+
+	ed25519_copy(r_out, &r);
+}
+
+#endif
+
+void ed25519_niels_batch(struct ed25519_niels *out,
+			 const struct ed25519_pt *p, size_t n,
+			 uint8_t *scratch)
+{
+	uint8_t *z = scratch + n * F25519_SIZE;
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		f25519_fe_tobytes(z + i * F25519_SIZE, &p[i].z);
+
+	f25519_inv_batch(z, z, n, scratch);
+
+	for (i = 0; i < n; i++) {
+		struct f25519_fe z1;
+		struct f25519_fe x;
+		struct f25519_fe y;
+
+		f25519_fe_frombytes(&z1, z + i * F25519_SIZE);
+		f25519_fe_mul(&x, &p[i].x, &z1);
+		f25519_fe_mul(&y, &p[i].y, &z1);
+
+		f25519_fe_add(&out[i].yplusx, &y, &x);
+		f25519_fe_sub(&out[i].yminusx, &y, &x);
+		f25519_fe_mul(&z1, &x, &y);
+		f25519_fe_mul(&out[i].xy2d, &z1, &ed25519_k);
+	}
+}
+
+void ed25519_niels_table(struct ed25519_niels *tab,
+			 const struct ed25519_pt *p)
+{
+	struct ed25519_pt row[8];
+	struct ed25519_pt base;
+	uint8_t scratch[16][F25519_SIZE];
+	int i;
+	int j;
+
+	ed25519_copy(&base, p);
+
+	for (i = 0; i < 32; i++) {
+		struct ed25519_cached_pt bc;
+
+		/* 1..8 times base, brought to affine form together */
+		ed25519_cache(&bc, &base);
+		ed25519_copy(&row[0], &base);
+		for (j = 1; j < 8; j++)
+			ed25519_add_cached(&row[j], &row[j - 1], &bc);
+
+		ed25519_niels_batch(tab + i * 8, row, 8, scratch[0]);
+
+		/* Next row: 256 * base = 2^5 * (8 * base) */
+		ed25519_double(&base, &row[7]);
+		for (j = 0; j < 4; j++)
+			ed25519_double(&base, &base);
+	}
+}
+
+void ed25519_smult_niels(struct ed25519_pt *r,
+			 const struct ed25519_niels *tab, const uint8_t *e)
+{
+	int8_t digit[64];
+
+	recode16(digit, e);
+	smult_niels(r, tab, digit);
+}
+
+#if ED25519_SMALL_STACK
+void ed25519_double_scalarmult_vartime(struct ed25519_pt *r_out,
+				       const uint8_t *a,
+				       const struct ed25519_pt *p,
+				       const uint8_t *b)
+{
+	struct ed25519_cached_pt tab[1 << (SLIDE_WIDTH - 1)];
+	struct ed25519_pt r;
+	int at_a;
+	int at_b;
+	int da = next_window(a, ED25519_EXPONENT_SIZE * 8 - 1, SLIDE_WIDTH,
+			     &at_a);
+	int db = next_window(b, ED25519_EXPONENT_SIZE * 8 - 1,
+			     ED25519_BASE_ODD_WIDTH - 1, &at_b);
+	const int top = at_a > at_b ? at_a : at_b;
+	int i;
+
+	odd_multiples(tab, &r, p, 1 << (SLIDE_WIDTH - 1));
+	ed25519_copy(&r, &ed25519_neutral);
+
+	for (i = top; i >= 0; i--) {
+		if (i < top)
+			double_pt(&r, &r, i == at_a || i == at_b || !i);
+
+		if (i == at_a) {
+			ed25519_add_cached(&r, &r, &tab[da >> 1]);
+			da = next_window(a, i - 1, SLIDE_WIDTH, &at_a);
+		}
+
+		if (i == at_b) {
+			ed25519_add_mixed(&r, &r, &ed25519_base_odd[db >> 1]);
+			db = next_window(b, i - 1, ED25519_BASE_ODD_WIDTH - 1,
+					 &at_b);
+		}
+	}
+
+	ed25519_copy(r_out, &r);
+}
+#else
+void ed25519_double_scalarmult_vartime(struct ed25519_pt *r_out,
+				       const uint8_t *a,
+				       const struct ed25519_pt *p,
+				       const uint8_t *b)
+{
+	struct ed25519_cached_pt tab[8];
+	struct ed25519_pt r;
+	struct ed25519_niels n;
+	int8_t naf_a[WNAF_LEN];
+	int8_t naf_b[WNAF_LEN];
+	const int top_a = wnaf(naf_a, a, 5);
+	const int top_b = wnaf(naf_b, b, ED25519_BASE_ODD_WIDTH);
+	const int top = top_a > top_b ? top_a : top_b;
+	int i;
+
+	odd_multiples(tab, &r, p, 8);
+	ed25519_copy(&r, &ed25519_neutral);
+
+	for (i = top; i >= 0; i--) {
+		if (i < top)
+			double_pt(&r, &r, naf_a[i] || naf_b[i] || !i);
+
+		if (naf_a[i] > 0)
+			add_signed(&r, &tab[naf_a[i] >> 1], 0);
+		else if (naf_a[i] < 0)
+			add_signed(&r, &tab[(-naf_a[i]) >> 1], 1);
+
+		if (naf_b[i] > 0) {
+			ed25519_add_mixed(&r, &r, &ed25519_base_odd[naf_b[i] >> 1]);
+		} else if (naf_b[i] < 0) {
+			memcpy(&n, &ed25519_base_odd[(-naf_b[i]) >> 1],
+			       sizeof(n));
+			cneg_niels(&n, 1);
+			ed25519_add_mixed(&r, &r, &n);
+		}
+	}
+
+	ed25519_copy(r_out, &r);
+}
+#endif
+
+static void msm_straus(struct ed25519_pt *r_out, const uint8_t *e,
+		       const struct ed25519_pt *p, size_t n,
+		       union ed25519_msm_scratch *scratch)
+{
+	int8_t *naf = (int8_t *)(scratch + n * 8);
+	struct ed25519_cached_pt tab[8];
+	struct ed25519_pt r;
+	int top = -1;
+	size_t j;
+	int i;
+
+	for (j = 0; j < n; j++) {
+		const int t = wnaf(naf + j * WNAF_LEN,
+				   e + j * ED25519_EXPONENT_SIZE, 5);
+
+		if (t > top)
+			top = t;
+
+		odd_multiples(tab, &r, &p[j], 8);
+		for (i = 0; i < 8; i++)
+			memcpy(&scratch[j * 8 + i].cached, &tab[i],
+			       sizeof(tab[i]));
+	}
+
+	ed25519_copy(&r, &ed25519_neutral);
+
+	for (i = top; i >= 0; i--) {
+		int any = !i;
+
+		for (j = 0; j < n && !any; j++)
+			any = naf[j * WNAF_LEN + i];
+
+		if (i < top)
+			double_pt(&r, &r, any);
+
+		for (j = 0; j < n; j++) {
+			const int8_t d = naf[j * WNAF_LEN + i];
+
+			if (d > 0)
+				add_signed(&r, &scratch[j * 8 + (d >> 1)].cached,
+					   0);
+			else if (d < 0)
+				add_signed(&r,
+					   &scratch[j * 8 + ((-d) >> 1)].cached,
+					   1);
+		}
+	}
+
+	ed25519_copy(r_out, &r);
+}
+
+/* Bits [i, i + w) of e, where w <= 16 */
+static unsigned int exp_window(const uint8_t *e, int i, int w)
+{
+	unsigned int v = 0;
+	int j;
+
+	for (j = 0; j < 3 && (i >> 3) + j < ED25519_EXPONENT_SIZE; j++)
+		v |= ((unsigned int)e[(i >> 3) + j]) << (j * 8);
+
+	return (v >> (i & 7)) & ((1u << w) - 1);
+}
+
+/* Sum of b * bucket[b - 1], for 1 <= b <= count, skipping the empty
+ * buckets. Returns 0 if the sum is the neutral point (and r is unset).
+ */
+static int sum_buckets(struct ed25519_pt *r,
+		       const union ed25519_msm_scratch *bucket,
+		       const uint8_t *used, int count)
+{
+	struct ed25519_pt run;
+	int have_run = 0;
+	int have_r = 0;
+	int b;
+
+	/* Running sum from the top, added in once per bucket */
+	for (b = count - 1; b >= 0; b--) {
+		if (used[b]) {
+			if (have_run)
+				ed25519_add(&run, &run, &bucket[b].pt);
+			else
+				ed25519_copy(&run, &bucket[b].pt);
+
+			have_run = 1;
+		}
+
+		if (!have_run)
+			continue;
+
+		if (have_r)
+			ed25519_add(r, r, &run);
+		else
+			ed25519_copy(r, &run);
+
+		have_r = 1;
+	}
+
+	return have_r;
+}
+
+static void msm_pippenger(struct ed25519_pt *r_out, const uint8_t *e,
+			  const struct ed25519_pt *p, size_t n,
+			  union ed25519_msm_scratch *scratch)
+{
+	const int w = ED25519_MSM_WINDOW(n);
+	const int count = (1 << w) - 1;
+	uint8_t *used = (uint8_t *)(scratch + count);
+	struct ed25519_pt r;
+	struct ed25519_pt s;
+	int i;
+
+	ed25519_copy(&r, &ed25519_neutral);
+
+	for (i = (ED25519_EXPONENT_SIZE * 8 - 1) / w * w; i >= 0; i -= w) {
+		size_t j;
+		int k;
+
+		for (k = 0; k < w; k++)
+			double_pt(&r, &r, k == w - 1);
+
+		/* Sort points into buckets by their digit */
+		memset(used, 0, count);
+
+		for (j = 0; j < n; j++) {
+			const unsigned int d =
+				exp_window(e + j * ED25519_EXPONENT_SIZE, i, w);
+
+			if (!d)
+				continue;
+
+			if (used[d - 1]) {
+				ed25519_add(&scratch[d - 1].pt,
+					    &scratch[d - 1].pt, &p[j]);
+			} else {
+				ed25519_copy(&scratch[d - 1].pt, &p[j]);
+				used[d - 1] = 1;
+			}
+		}
+
+		if (sum_buckets(&s, scratch, used, count))
+			ed25519_add(&r, &r, &s);
+	}
+
+	ed25519_copy(r_out, &r);
+}
+
+void ed25519_msm_vartime(struct ed25519_pt *r, const uint8_t *e,
+			 const struct ed25519_pt *p, size_t n,
+			 union ed25519_msm_scratch *scratch)
+{
+	if (n < ED25519_MSM_PIPPENGER_MIN)
+		msm_straus(r, e, p, n, scratch);
+	else
+		msm_pippenger(r, e, p, n, scratch);
+}
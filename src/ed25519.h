@@ -28,12 +28,35 @@
  *     Vol. 5350, pp. 326-343.
  */
 
-/* Projective coordinates */
+/* Projective coordinates. These are kept in the field backend's
+ * internal representation from ed25519_project() to ed25519_unproject().
+ */
 struct ed25519_pt {
-	uint8_t  x[F25519_SIZE];
-	uint8_t  y[F25519_SIZE];
-	uint8_t  t[F25519_SIZE];
-	uint8_t  z[F25519_SIZE];
+	struct f25519_fe  x;
+	struct f25519_fe  y;
+	struct f25519_fe  t;
+	struct f25519_fe  z;
+};
+
+/* Affine point in the form (y+x, y-x, 2dxy), as used for precomputed
+ * tables. Adding one of these to a projective point saves a
+ * multiplication and the Z coordinate.
+ */
+struct ed25519_niels {
+	struct f25519_fe  yplusx;
+	struct f25519_fe  yminusx;
+	struct f25519_fe  xy2d;
+};
+
+/* Cached form (Y+X, Y-X, Z, 2dT) of a projective point. Converting a
+ * point that will be added many times saves a multiplication and two
+ * additions in each ed25519_add_cached().
+ */
+struct ed25519_cached_pt {
+	struct f25519_fe  yplusx;
+	struct f25519_fe  yminusx;
+	struct f25519_fe  z;
+	struct f25519_fe  t2d;
 };
 
 extern const struct ed25519_pt ed25519_base;
@@ -46,6 +69,14 @@ void ed25519_project(struct ed25519_pt *p,
 void ed25519_unproject(uint8_t *x, uint8_t *y,
 		       const struct ed25519_pt *p);
 
+/* Convert n points to affine coordinates at once, sharing a single
+ * field inversion. x and y receive arrays of n elements, and scratch
+ * must have room for n field elements (n * F25519_SIZE bytes).
+ */
+void ed25519_unproject_batch(uint8_t *x, uint8_t *y,
+			     const struct ed25519_pt *p, size_t n,
+			     uint8_t *scratch);
+
 /* Compress/uncompress points. try_unpack() will check that the
  * compressed point is on the curve, returning 1 if the unpacked point
  * is valid, and 0 otherwise.
@@ -55,6 +86,13 @@ void ed25519_unproject(uint8_t *x, uint8_t *y,
 void ed25519_pack(uint8_t *c, const uint8_t *x, const uint8_t *y);
 uint8_t ed25519_try_unpack(uint8_t *x, uint8_t *y, const uint8_t *c);
 
+/* Compress n projective points at once, sharing a single field
+ * inversion. c receives n packed points of ED25519_PACK_SIZE bytes each,
+ * and scratch must have room for n field elements.
+ */
+void ed25519_pack_batch(uint8_t *c, const struct ed25519_pt *p, size_t n,
+			uint8_t *scratch);
+
 /* Add, double and scalar multiply */
 #define ED25519_EXPONENT_SIZE  32
 
@@ -75,8 +113,159 @@ static inline void ed25519_copy(struct ed25519_pt *dst,
 
 void ed25519_add(struct ed25519_pt *r,
 		 const struct ed25519_pt *a, const struct ed25519_pt *b);
+
+void ed25519_cache(struct ed25519_cached_pt *c, const struct ed25519_pt *p);
+void ed25519_add_cached(struct ed25519_pt *r, const struct ed25519_pt *a,
+			const struct ed25519_cached_pt *b);
+
+/* Add an affine point to a projective point. Since Z2 = 1, this is one
+ * multiplication cheaper than ed25519_add_cached().
+ */
+void ed25519_add_mixed(struct ed25519_pt *r, const struct ed25519_pt *a,
+		       const struct ed25519_niels *b);
+
+/* Bring n projective points to affine form, sharing a single field
+ * inversion. scratch must have room for 2n field elements
+ * (2n * F25519_SIZE bytes).
+ */
+void ed25519_niels_batch(struct ed25519_niels *out,
+			 const struct ed25519_pt *p, size_t n,
+			 uint8_t *scratch);
+
 void ed25519_double(struct ed25519_pt *r, const struct ed25519_pt *a);
 void ed25519_smult(struct ed25519_pt *r, const struct ed25519_pt *a,
 		   const uint8_t *e);
 
+/* Variable-time scalar multiply, for public scalars only (such as in
+ * signature verification). The running time depends on e. This uses a
+ * width-5 NAF with a table of the odd multiples P, 3P, ..., 15P, and
+ * costs about 256 doublings but only about 50 additions.
+ *
+ * If ED25519_SMALL_STACK is non-zero, the digits are instead found as
+ * they're needed, in sliding windows of 3 bits, and the table holds
+ * only P, 3P, 5P and 7P. This needs about 64 additions, but less than
+ * half the stack.
+ */
+#ifndef ED25519_SMALL_STACK
+#if F25519_RADIX == 8 || ED25519_COMB
+#define ED25519_SMALL_STACK  1
+#else
+#define ED25519_SMALL_STACK  0
+#endif
+#endif
+
+void ed25519_smult_vartime(struct ed25519_pt *r, const struct ed25519_pt *p,
+			   const uint8_t *e);
+
+/* Set r = aP + bB, where B is the base point, in one joint loop over
+ * the NAFs of a and b. a and b are full 256-bit exponents. As for
+ * ed25519_smult_vartime(), this is for public data only. The two
+ * multiplies share their 256 doublings, and the odd multiples of B come
+ * from a fixed table (see ed25519_tab.h). With ED25519_SMALL_STACK,
+ * both use sliding windows in the same way as ed25519_smult_vartime().
+ */
+void ed25519_double_scalarmult_vartime(struct ed25519_pt *r,
+				       const uint8_t *a,
+				       const struct ed25519_pt *p,
+				       const uint8_t *b);
+
+/* Set r to the sum of e[i] * p[i], for 0 <= i < n, where e holds n
+ * exponents of ED25519_EXPONENT_SIZE bytes each. This is variable-time,
+ * for public data only. scratch must have room for
+ * ED25519_MSM_SCRATCH(n) entries, each of which holds a bucket or a
+ * cached table point.
+ *
+ * Below ED25519_MSM_PIPPENGER_MIN points, this is a Straus multiply
+ * over width-5 NAFs: about 57 additions per point, and 256 doublings
+ * shared by all. From there on, it uses Pippenger's bucket method with
+ * windows of ED25519_MSM_WINDOW(n) bits. The cost per point then falls
+ * as n grows, to about 25 additions at n = 2^16, and scratch holds
+ * 2^w - 1 buckets (about 650 kB at most with the limb backends).
+ *
+ * ED25519_MSM_SCRATCH(n) is not monotonic in n: the Straus tables just
+ * below ED25519_MSM_PIPPENGER_MIN are larger than the buckets for the
+ * next few window sizes, but smaller than those for the widest. A
+ * buffer that must serve any number of points up to n should have
+ * ED25519_MSM_SCRATCH_UPTO(n) entries, or ED25519_MSM_SCRATCH_MAX for
+ * any n at all.
+ */
+union ed25519_msm_scratch {
+	struct ed25519_pt         pt;
+	struct ed25519_cached_pt  cached;
+};
+
+#define ED25519_MSM_PIPPENGER_MIN  256
+
+#define ED25519_MSM_WINDOW(n) \
+	((n) < 512 ? 5 : (n) < 1024 ? 6 : (n) < 2048 ? 7 : \
+	 (n) < 4096 ? 8 : (n) < 8192 ? 9 : (n) < 16384 ? 10 : \
+	 (n) < 32768 ? 11 : 12)
+
+#define ED25519_MSM_SCRATCH_STRAUS(n) \
+	((n) * 8 + ((n) * (ED25519_EXPONENT_SIZE * 8 + 1) + \
+		     sizeof(union ed25519_msm_scratch) - 1) / \
+		     sizeof(union ed25519_msm_scratch))
+
+#define ED25519_MSM_SCRATCH_PIPPENGER(w) \
+	((1 << (w)) - 1 + \
+	 ((1 << (w)) + sizeof(union ed25519_msm_scratch) - 1) / \
+	 sizeof(union ed25519_msm_scratch))
+
+#define ED25519_MSM_SCRATCH(n) \
+	((n) < ED25519_MSM_PIPPENGER_MIN ? ED25519_MSM_SCRATCH_STRAUS(n) : \
+	 ED25519_MSM_SCRATCH_PIPPENGER(ED25519_MSM_WINDOW(n)))
+
+#define ED25519_MSM_SCRATCH_MAX_STRAUS \
+	ED25519_MSM_SCRATCH_STRAUS(ED25519_MSM_PIPPENGER_MIN - 1)
+
+#define ED25519_MSM_SCRATCH_MAX_PIPPENGER \
+	ED25519_MSM_SCRATCH_PIPPENGER(12)
+
+#define ED25519_MSM_SCRATCH_MAX \
+	(ED25519_MSM_SCRATCH_MAX_STRAUS > ED25519_MSM_SCRATCH_MAX_PIPPENGER ? \
+	 ED25519_MSM_SCRATCH_MAX_STRAUS : ED25519_MSM_SCRATCH_MAX_PIPPENGER)
+
+/* Enough for any number of points up to n */
+#define ED25519_MSM_SCRATCH_UPTO(n) \
+	((n) < ED25519_MSM_PIPPENGER_MIN ? ED25519_MSM_SCRATCH_STRAUS(n) : \
+	 ED25519_MSM_SCRATCH_MAX_STRAUS > \
+	 ED25519_MSM_SCRATCH_PIPPENGER(ED25519_MSM_WINDOW(n)) ? \
+	 ED25519_MSM_SCRATCH_MAX_STRAUS : \
+	 ED25519_MSM_SCRATCH_PIPPENGER(ED25519_MSM_WINDOW(n)))
+
+void ed25519_msm_vartime(struct ed25519_pt *r, const uint8_t *e,
+			 const struct ed25519_pt *p, size_t n,
+			 union ed25519_msm_scratch *scratch);
+
+/* Compute two independent scalar multiplies in one interleaved loop.
+ * r and p point to two points each, and e to two exponents, and
+ * r[i] = ed25519_smult(p[i], e[i]), with identical coordinates. The
+ * field operations of the two alternate, so that each fills the
+ * other's pipeline stalls. r may be the same array as p.
+ */
+void ed25519_smult2(struct ed25519_pt *r, const struct ed25519_pt *p,
+		    const uint8_t *e);
+
+/* Multiply the base point by e. This gives the same result as
+ * ed25519_smult(r, &ed25519_base, e), but uses a precomputed table
+ * (see ed25519_tab.h). With the default table, this costs 65 mixed
+ * additions (64 digits and a carry) and 4 doublings rather than 256 of
+ * each.
+ */
+void ed25519_smult_base(struct ed25519_pt *r, const uint8_t *e);
+
+/* Build a fixed-base table for p, laid out like the one used by
+ * ed25519_smult_base(). tab has ED25519_NIELS_TABLE_SIZE entries, and
+ * entry 8i + j is (j+1) * 16^(2i) * p. This costs 32 inversions and
+ * about 400 point operations.
+ */
+#define ED25519_NIELS_TABLE_SIZE  256
+
+void ed25519_niels_table(struct ed25519_niels *tab,
+			 const struct ed25519_pt *p);
+
+/* Multiply the point that tab was built for by e, where e < 2^255 */
+void ed25519_smult_niels(struct ed25519_pt *r,
+			 const struct ed25519_niels *tab, const uint8_t *e);
+
 #endif
@@ -0,0 +1,100 @@
+/* Precomputed multiples of the Edwards base point
+ *
+ * This file is in the public domain.
+ */
+
+#ifndef ED25519_TAB_H_
+#define ED25519_TAB_H_
+
+#include "ed25519.h"
+
+/* The fixed-base method is chosen at compile time with ED25519_COMB:
+ *
+ *      0: signed radix-16 table of 256 entries (the default)
+ *      8, 16, 32, 64: a Lim-Lee signed comb, with this many entries
+ *
+ * Each entry is three field elements: 96 bytes with F25519_RADIX=8, or
+ * 120 bytes with the limb backends. Point operations per
+ * ed25519_smult_base() call, and time relative to ed25519_smult() on
+ * the same base point (x86-64, F25519_RADIX=8), are:
+ *
+ *    ED25519_COMB  Teeth x combs  ROM (radix 8)  Dbl + add  Time
+ *    ------------------------------------------------------------
+ *               8         4 x 1          768 B    64 + 65   0.26
+ *              16         4 x 2         1536 B    32 + 66   0.20
+ *              32         5 x 2         3072 B    25 + 52   0.16
+ *              64         5 x 4         6144 B    12 + 52   0.13
+ *               0             -        24576 B     4 + 65   0.14
+ *
+ * ed25519_smult() takes 256 of each. All methods keep the scalar and
+ * table lookups constant-time. The comb needs a 33-byte copy of the
+ * scalar, but otherwise the same stack as ed25519_smult().
+ */
+#ifndef ED25519_COMB
+#define ED25519_COMB  0
+#endif
+
+#if ED25519_COMB == 0
+
+/* Fixed-base table for ed25519_smult_base(), in signed radix 16. Row i
+ * holds 1..8 times 16^(2i) * B, so that one row serves both digit
+ * positions 2i and 2i+1 (the odd positions are shifted into place by
+ * four doublings at the end).
+ */
+extern const struct ed25519_niels ed25519_base_tab[32][8];
+
+/* 2^256 * B. A 256-bit scalar with the top bit set carries out of the
+ * last signed digit, and this point accounts for the carry.
+ */
+extern const struct ed25519_niels ed25519_base_tab_carry;
+
+#else
+
+#if ED25519_COMB == 8
+#define ED25519_COMB_TEETH  4
+#define ED25519_COMB_COMBS  1
+#elif ED25519_COMB == 16
+#define ED25519_COMB_TEETH  4
+#define ED25519_COMB_COMBS  2
+#elif ED25519_COMB == 32
+#define ED25519_COMB_TEETH  5
+#define ED25519_COMB_COMBS  2
+#elif ED25519_COMB == 64
+#define ED25519_COMB_TEETH  5
+#define ED25519_COMB_COMBS  4
+#else
+#error "ED25519_COMB must be 0, 8, 16, 32 or 64"
+#endif
+
+/* Teeth are this many bits apart. The combs together must span 257
+ * signed digits (see ed25519_smult_base()).
+ */
+#define ED25519_COMB_SPACING \
+	((256 + ED25519_COMB_TEETH * ED25519_COMB_COMBS) / \
+	 (ED25519_COMB_TEETH * ED25519_COMB_COMBS))
+
+/* Write s = SPACING, w = TEETH and b(t) = 2^(s(t + wj)). Entry i of
+ * comb j is the sum of b(0) B and of +/- b(t) B for 0 < t < w, where
+ * the sign is that of bit t-1 of i (set for +).
+ */
+extern const struct ed25519_niels
+	ed25519_comb_tab[ED25519_COMB_COMBS][1 << (ED25519_COMB_TEETH - 1)];
+
+#endif
+
+/* ed25519_base_odd[i] is (2i + 1) * B, for the NAF of b in
+ * ed25519_double_scalarmult_vartime(). Builds with the full radix-16
+ * table use a width-7 NAF and 32 entries here, and comb builds use a
+ * width-5 NAF and 8 entries (768 bytes with radix 8).
+ */
+#if ED25519_COMB == 0
+#define ED25519_BASE_ODD_WIDTH  7
+#else
+#define ED25519_BASE_ODD_WIDTH  5
+#endif
+
+#define ED25519_BASE_ODD_SIZE  (1 << (ED25519_BASE_ODD_WIDTH - 2))
+
+extern const struct ed25519_niels ed25519_base_odd[ED25519_BASE_ODD_SIZE];
+
+#endif
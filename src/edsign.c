@@ -28,16 +28,6 @@ static void expand_key(uint8_t *expanded, const uint8_t *secret)
 	ed25519_prepare(expanded);
 }
 
-static uint8_t upp(struct ed25519_pt *p, const uint8_t *packed)
-{
-	uint8_t x[F25519_SIZE];
-	uint8_t y[F25519_SIZE];
-	uint8_t ok = ed25519_try_unpack(x, y, packed);
-
-	ed25519_project(p, x, y);
-	return ok;
-}
-
 static void pp(uint8_t *packed, const struct ed25519_pt *p)
 {
 	uint8_t x[F25519_SIZE];
@@ -51,7 +41,7 @@ static void sm_pack(uint8_t *r, const uint8_t *k)
 {
 	struct ed25519_pt p;
 
-	ed25519_smult(&p, &ed25519_base, k);
+	ed25519_smult_base(&p, k);
 	pp(r, &p);
 }
 
@@ -144,25 +134,249 @@ uint8_t edsign_verify(const uint8_t *signature, const uint8_t *pub,
 		      const uint8_t *message, size_t len)
 {
 	struct ed25519_pt p;
-	struct ed25519_pt q;
-	uint8_t lhs[F25519_SIZE];
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
 	uint8_t rhs[F25519_SIZE];
 	uint8_t z[FPRIME_SIZE];
-	uint8_t ok = 1;
+	uint8_t ok;
 
 	/* Compute z = H(R, A, M) */
 	hash_message(z, signature, pub, message, len);
 
-	/* sB = (ze + k)B = ... */
-	sm_pack(lhs, signature + 32);
+	/* -A */
+	ok = ed25519_try_unpack(x, y, pub);
+	f25519_neg(x, x);
+	ed25519_project(&p, x, y);
 
-	/* ... = zA + R */
-	ok &= upp(&p, pub);
-	ed25519_smult(&p, &p, z);
-	ok &= upp(&q, signature);
-	ed25519_add(&p, &p, &q);
+	/* R = sB - zA, computed in one pass. All of these are public. */
+	ed25519_double_scalarmult_vartime(&p, z, &p, signature + 32);
 	pp(rhs, &p);
 
-	/* Equal? */
-	return ok & f25519_eq(lhs, rhs);
+	/* Equal to the packed R? */
+	return ok & f25519_eq(rhs, signature);
+}
+
+/* r += a b, where r has room for alen + blen bytes. This is plain
+ * integer arithmetic, and variable-time.
+ */
+static void mul_add(uint8_t *r, const uint8_t *a, int alen,
+		    const uint8_t *b, int blen)
+{
+	int i;
+	int j;
+
+	for (i = 0; i < blen; i++) {
+		uint32_t c = 0;
+
+		for (j = 0; j < alen; j++) {
+			c += r[i + j] + (uint32_t)a[j] * b[i];
+			r[i + j] = c;
+			c >>= 8;
+		}
+
+		for (j = i + alen; c; j++) {
+			c += r[j];
+			r[j] = c;
+			c >>= 8;
+		}
+	}
+}
+
+/* Given x < 2^381, find r < 2^255 with r = x mod l. Write l = 2^252 + c
+ * and x = lo + hi 2^252. Then x = lo - hi c (mod l), and hi c < 2^254,
+ * so r = lo + 4l - hi c. This avoids the bit-serial reduction in
+ * fprime_from_bytes().
+ */
+#define WIDE_SIZE  48
+
+static void fold_order(uint8_t *r, const uint8_t *x)
+{
+	uint8_t hi[WIDE_SIZE - 31];
+	uint8_t t[WIDE_SIZE + 2];
+	uint16_t c = 0;
+	int i;
+
+	for (i = 0; i < WIDE_SIZE - 32; i++)
+		hi[i] = (x[31 + i] >> 4) | (x[32 + i] << 4);
+
+	hi[i] = x[31 + i] >> 4;
+
+	memset(t, 0, sizeof(t));
+	mul_add(t, hi, sizeof(hi), ed25519_order, 16);
+
+	/* r = lo + 4l */
+	for (i = 0; i < FPRIME_SIZE; i++) {
+		const uint8_t lo = i < 31 ? x[i] : x[i] & 0xf;
+		const uint8_t l4 = (ed25519_order[i] << 2) |
+			(i ? ed25519_order[i - 1] >> 6 : 0);
+
+		c += lo + l4;
+		r[i] = c;
+		c >>= 8;
+	}
+
+	/* r -= hi c */
+	c = 0;
+	for (i = 0; i < FPRIME_SIZE; i++) {
+		c = r[i] - t[i] - c;
+		r[i] = c;
+		c = (c >> 8) & 1;
+	}
+}
+
+/* Is p of small order (8p = 0)? The combined check below can't see
+ * small-order components reliably, since the weights may cancel them.
+ */
+static uint8_t small_order(const struct ed25519_pt *p)
+{
+	struct ed25519_pt q;
+
+	ed25519_double(&q, p);
+	ed25519_double(&q, &q);
+	ed25519_double(&q, &q);
+
+	return f25519_fe_eq(&q.x, &f25519_fe_zero);
+}
+
+/* Verify n signatures by checking that
+ *
+ *     (sum of w[i] s[i]) B - (sum of w[i] R[i]) - (sum of w[i] z[i] A[i])
+ *
+ * is the neutral point, for random weights w[i]. Returns 0 if not, or
+ * if any R or A fails to unpack or is of small order.
+ */
+#define WEIGHT_SIZE  16
+
+static uint8_t verify_group(const uint8_t *const *signature,
+			    const uint8_t *const *pub,
+			    const uint8_t *const *message, const size_t *len,
+			    size_t n, union ed25519_msm_scratch *scratch)
+{
+	/* Points, then their exponents, then the multiply's own scratch */
+	struct ed25519_pt *p = &scratch[0].pt;
+	uint8_t (*e)[FPRIME_SIZE] = (uint8_t (*)[FPRIME_SIZE])
+		(scratch + 2 * n + 1);
+	union ed25519_msm_scratch *msm = scratch + 2 * n + 1 +
+		((2 * n + 1) * FPRIME_SIZE + sizeof(*scratch) - 1) /
+		sizeof(*scratch);
+	uint8_t sum[FPRIME_SIZE];
+	uint8_t block[SHA512_BLOCK_SIZE];
+	uint8_t seed[SHA512_HASH_SIZE];
+	struct sha512_state hs;
+	uint8_t ok = 1;
+	size_t i;
+
+	/* Hash everything together to seed the weights. z[i] is kept in
+	 * e[2i + 2] until its weighted form replaces it.
+	 */
+	sha512_init(&hs);
+
+	for (i = 0; i < n; i++) {
+		uint8_t *z = e[2 * i + 2];
+
+		hash_message(z, signature[i], pub[i], message[i], len[i]);
+
+		memcpy(block, signature[i], EDSIGN_SIGNATURE_SIZE);
+		memcpy(block + 64, pub[i], EDSIGN_PUBLIC_KEY_SIZE);
+		memcpy(block + 96, z, FPRIME_SIZE);
+		sha512_block(&hs, block);
+	}
+
+	/* The stream is whole blocks, so nothing more is read here */
+	memset(sum, 0, sizeof(sum));
+	sha512_final(&hs, sum, n * SHA512_BLOCK_SIZE);
+	sha512_get(&hs, seed, 0, SHA512_HASH_SIZE);
+
+	ed25519_copy(&p[0], &ed25519_base);
+
+	for (i = 0; i < n; i++) {
+		uint8_t w[WEIGHT_SIZE];
+		uint8_t wide[WIDE_SIZE];
+		uint8_t x[F25519_SIZE];
+		uint8_t y[F25519_SIZE];
+		uint8_t c[F25519_SIZE];
+		uint16_t carry = 0;
+		int j;
+
+		/* w = H(seed, i), truncated to 128 bits */
+		memcpy(block, seed, SHA512_HASH_SIZE);
+		for (j = 0; j < 8; j++)
+			block[SHA512_HASH_SIZE + j] = (uint64_t)i >> (j * 8);
+
+		sha512_init(&hs);
+		sha512_final(&hs, block, SHA512_HASH_SIZE + 8);
+		sha512_get(&hs, w, 0, WEIGHT_SIZE);
+
+		/* w s B, summed over all signatures. w s < 2^381, and the
+		 * running sum is kept below 2^255 by folding each time.
+		 */
+		fprime_from_bytes(c, signature[i] + 32, 32, ed25519_order);
+		memset(wide, 0, sizeof(wide));
+		mul_add(wide, c, FPRIME_SIZE, w, WEIGHT_SIZE);
+
+		for (j = 0; j < WIDE_SIZE; j++) {
+			carry += wide[j] + (j < FPRIME_SIZE ? sum[j] : 0);
+			wide[j] = carry;
+			carry >>= 8;
+		}
+
+		fold_order(sum, wide);
+
+		/* -w R. As in edsign_verify(), R must be canonical. */
+		ok &= ed25519_try_unpack(x, y, signature[i]);
+		ed25519_pack(c, x, y);
+		ok &= f25519_eq(c, signature[i]);
+		f25519_neg(x, x);
+		ed25519_project(&p[2 * i + 1], x, y);
+		ok &= !small_order(&p[2 * i + 1]);
+		memset(e[2 * i + 1], 0, FPRIME_SIZE);
+		memcpy(e[2 * i + 1], w, WEIGHT_SIZE);
+
+		/* -w z A */
+		ok &= ed25519_try_unpack(x, y, pub[i]);
+		f25519_neg(x, x);
+		ed25519_project(&p[2 * i + 2], x, y);
+		ok &= !small_order(&p[2 * i + 2]);
+		memset(wide, 0, sizeof(wide));
+		mul_add(wide, e[2 * i + 2], FPRIME_SIZE, w, WEIGHT_SIZE);
+		fold_order(e[2 * i + 2], wide);
+	}
+
+	if (!ok)
+		return 0;
+
+	fprime_from_bytes(e[0], sum, sizeof(sum), ed25519_order);
+	ed25519_msm_vartime(&p[0], e[0], p, 2 * n + 1, msm);
+
+	return f25519_fe_eq(&p[0].x, &f25519_fe_zero) &
+		f25519_fe_eq(&p[0].y, &p[0].z);
+}
+
+uint8_t edsign_verify_batch(const uint8_t *const *signature,
+			    const uint8_t *const *pub,
+			    const uint8_t *const *message, const size_t *len,
+			    size_t n, uint8_t *results, size_t group,
+			    union ed25519_msm_scratch *scratch)
+{
+	uint8_t all_ok = 1;
+	size_t i;
+
+	for (i = 0; i < n; i += group) {
+		const size_t m = n - i < group ? n - i : group;
+		size_t j;
+
+		if (verify_group(signature + i, pub + i, message + i,
+				 len + i, m, scratch)) {
+			memset(results + i, 1, m);
+			continue;
+		}
+
+		for (j = i; j < i + m; j++) {
+			results[j] = edsign_verify(signature[j], pub[j],
+						   message[j], len[j]);
+			all_ok &= results[j];
+		}
+	}
+
+	return all_ok;
 }
@@ -5,10 +5,14 @@
  */
 
 #include "f25519.h"
+#include "modinv.h"
 
 const uint8_t f25519_zero[F25519_SIZE] = {0};
 const uint8_t f25519_one[F25519_SIZE] = {1};
 
+const struct f25519_fe f25519_fe_zero = {{0}};
+const struct f25519_fe f25519_fe_one = {{1}};
+
 void f25519_load(uint8_t *x, uint32_t c)
 {
 	unsigned int i;
@@ -83,6 +87,720 @@ void f25519_select(uint8_t *dst,
 		dst[i] = zero[i] ^ (mask & (one[i] ^ zero[i]));
 }
 
+#if F25519_RADIX == 51
+
+/* 64-bit backend. A struct f25519_fe holds five 51-bit limbs, and
+ * products are computed with 64x64->128 multiplies. Byte strings are
+ * unpacked into limbs on the way in and packed back into fully reduced
+ * bytes on the way out.
+ *
+ * Limbs loaded from bytes are less than 2^52 (the top limb carries bit
+ * 255 of un-normalized input). The multiplier accepts limbs up to 2^54,
+ * which leaves room for the lazy add/sub results (less than 2^53).
+ */
+__extension__ typedef unsigned __int128 uint128_t;
+typedef uint64_t limb_t;
+
+#define F25519_LIMBS  5
+
+#define LIMB_BITS  51
+#define LIMB_MASK  ((((uint64_t)1) << LIMB_BITS) - 1)
+
+static uint64_t load64(const uint8_t *x)
+{
+	uint64_t r = 0;
+	int i;
+
+	for (i = 7; i >= 0; i--)
+		r = (r << 8) | x[i];
+
+	return r;
+}
+
+static void store64(uint8_t *x, uint64_t c)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		x[i] = c;
+		c >>= 8;
+	}
+}
+
+static void unpack(uint64_t *l, const uint8_t *x)
+{
+	const uint64_t w0 = load64(x);
+	const uint64_t w1 = load64(x + 8);
+	const uint64_t w2 = load64(x + 16);
+	const uint64_t w3 = load64(x + 24);
+
+	l[0] = w0 & LIMB_MASK;
+	l[1] = ((w0 >> 51) | (w1 << 13)) & LIMB_MASK;
+	l[2] = ((w1 >> 38) | (w2 << 26)) & LIMB_MASK;
+	l[3] = ((w2 >> 25) | (w3 << 39)) & LIMB_MASK;
+	l[4] = w3 >> 12;
+}
+
+/* Propagate carries, reducing with 2^255 = 19 mod p. Input limbs must
+ * be less than 2^63. On output, every limb is less than 2^51, except
+ * that l[1] may be slightly larger.
+ */
+static void carry(uint64_t *l)
+{
+	l[1] += l[0] >> LIMB_BITS;
+	l[0] &= LIMB_MASK;
+	l[2] += l[1] >> LIMB_BITS;
+	l[1] &= LIMB_MASK;
+	l[3] += l[2] >> LIMB_BITS;
+	l[2] &= LIMB_MASK;
+	l[4] += l[3] >> LIMB_BITS;
+	l[3] &= LIMB_MASK;
+	l[0] += (l[4] >> LIMB_BITS) * 19;
+	l[4] &= LIMB_MASK;
+	l[1] += l[0] >> LIMB_BITS;
+	l[0] &= LIMB_MASK;
+}
+
+static void pack(uint8_t *x, const uint64_t *in)
+{
+	uint64_t l[5];
+	uint64_t q;
+
+	memcpy(l, in, sizeof(l));
+	carry(l);
+	carry(l);
+
+	/* The value is now less than 2p. Find out whether it's at least
+	 * p by checking whether adding 19 carries past bit 255.
+	 */
+	q = (l[0] + 19) >> LIMB_BITS;
+	q = (l[1] + q) >> LIMB_BITS;
+	q = (l[2] + q) >> LIMB_BITS;
+	q = (l[3] + q) >> LIMB_BITS;
+	q = (l[4] + q) >> LIMB_BITS;
+
+	/* Subtract p if necessary, by adding 19 and dropping bit 255 */
+	l[0] += 19 * q;
+	l[1] += l[0] >> LIMB_BITS;
+	l[0] &= LIMB_MASK;
+	l[2] += l[1] >> LIMB_BITS;
+	l[1] &= LIMB_MASK;
+	l[3] += l[2] >> LIMB_BITS;
+	l[2] &= LIMB_MASK;
+	l[4] += l[3] >> LIMB_BITS;
+	l[3] &= LIMB_MASK;
+	l[4] &= LIMB_MASK;
+
+	store64(x, l[0] | (l[1] << 51));
+	store64(x + 8, (l[1] >> 13) | (l[2] << 38));
+	store64(x + 16, (l[2] >> 26) | (l[3] << 25));
+	store64(x + 24, (l[3] >> 39) | (l[4] << 12));
+}
+
+/* Fold a column-sum vector into reduced limbs */
+static void carry_wide(uint64_t *r, uint128_t *t)
+{
+	uint128_t c;
+
+	t[1] += t[0] >> LIMB_BITS;
+	t[2] += t[1] >> LIMB_BITS;
+	t[3] += t[2] >> LIMB_BITS;
+	t[4] += t[3] >> LIMB_BITS;
+
+	c = (t[0] & LIMB_MASK) + (t[4] >> LIMB_BITS) * 19;
+
+	r[0] = ((uint64_t)c) & LIMB_MASK;
+	r[1] = (((uint64_t)t[1]) & LIMB_MASK) + (uint64_t)(c >> LIMB_BITS);
+	r[2] = ((uint64_t)t[2]) & LIMB_MASK;
+	r[3] = ((uint64_t)t[3]) & LIMB_MASK;
+	r[4] = ((uint64_t)t[4]) & LIMB_MASK;
+}
+
+static void mul_limbs(uint64_t *r, const uint64_t *a, const uint64_t *b)
+{
+	const uint64_t b1_19 = b[1] * 19;
+	const uint64_t b2_19 = b[2] * 19;
+	const uint64_t b3_19 = b[3] * 19;
+	const uint64_t b4_19 = b[4] * 19;
+	uint128_t t[5];
+
+	t[0] = ((uint128_t)a[0]) * b[0] + ((uint128_t)a[1]) * b4_19 +
+	       ((uint128_t)a[2]) * b3_19 + ((uint128_t)a[3]) * b2_19 +
+	       ((uint128_t)a[4]) * b1_19;
+	t[1] = ((uint128_t)a[0]) * b[1] + ((uint128_t)a[1]) * b[0] +
+	       ((uint128_t)a[2]) * b4_19 + ((uint128_t)a[3]) * b3_19 +
+	       ((uint128_t)a[4]) * b2_19;
+	t[2] = ((uint128_t)a[0]) * b[2] + ((uint128_t)a[1]) * b[1] +
+	       ((uint128_t)a[2]) * b[0] + ((uint128_t)a[3]) * b4_19 +
+	       ((uint128_t)a[4]) * b3_19;
+	t[3] = ((uint128_t)a[0]) * b[3] + ((uint128_t)a[1]) * b[2] +
+	       ((uint128_t)a[2]) * b[1] + ((uint128_t)a[3]) * b[0] +
+	       ((uint128_t)a[4]) * b4_19;
+	t[4] = ((uint128_t)a[0]) * b[4] + ((uint128_t)a[1]) * b[3] +
+	       ((uint128_t)a[2]) * b[2] + ((uint128_t)a[3]) * b[1] +
+	       ((uint128_t)a[4]) * b[0];
+
+	carry_wide(r, t);
+}
+
+static void sqr_limbs(uint64_t *r, const uint64_t *a)
+{
+	const uint64_t a0_2 = a[0] * 2;
+	const uint64_t a1_2 = a[1] * 2;
+	const uint64_t a2_2 = a[2] * 2;
+	const uint64_t a3_19 = a[3] * 19;
+	const uint64_t a4_19 = a[4] * 19;
+	uint128_t t[5];
+
+	t[0] = ((uint128_t)a[0]) * a[0] + ((uint128_t)a1_2) * a4_19 +
+	       ((uint128_t)a2_2) * a3_19;
+	t[1] = ((uint128_t)a0_2) * a[1] + ((uint128_t)a2_2) * a4_19 +
+	       ((uint128_t)a[3]) * a3_19;
+	t[2] = ((uint128_t)a0_2) * a[2] + ((uint128_t)a[1]) * a[1] +
+	       ((uint128_t)(a[3] * 2)) * a4_19;
+	t[3] = ((uint128_t)a0_2) * a[3] + ((uint128_t)a1_2) * a[2] +
+	       ((uint128_t)a[4]) * a4_19;
+	t[4] = ((uint128_t)a0_2) * a[4] + ((uint128_t)a1_2) * a[3] +
+	       ((uint128_t)a[2]) * a[2];
+
+	carry_wide(r, t);
+}
+
+static void mul_c_limbs(uint64_t *r, const uint64_t *a, uint32_t b)
+{
+	uint128_t t[5];
+	int i;
+
+	for (i = 0; i < 5; i++)
+		t[i] = ((uint128_t)a[i]) * b;
+
+	carry_wide(r, t);
+}
+
+/* 4p, limb by limb. Adding this before subtracting an unpacked or
+ * carried value (limbs less than 2^52) avoids underflow.
+ */
+static const uint64_t four_p[5] = {
+	0x1fffffffffffb4, 0x1ffffffffffffc, 0x1ffffffffffffc,
+	0x1ffffffffffffc, 0x1ffffffffffffc
+};
+
+/* 2p, limb by limb. This is enough for carried values, and is used by
+ * the lazy subtraction to keep its results small.
+ */
+static const uint64_t two_p[5] = {
+	0xfffffffffffda, 0xffffffffffffe, 0xffffffffffffe,
+	0xffffffffffffe, 0xffffffffffffe
+};
+
+#elif F25519_RADIX == 25
+
+/* 32-bit backend. A struct f25519_fe holds ten limbs of alternately
+ * 26 and 25 bits (radix 2^25.5), so that products need only 32x32->64
+ * multiplies.
+ *
+ * Limbs loaded from bytes are less than 2^26 (the top limb carries bit
+ * 255 of un-normalized input). The multiplier accepts limbs up to 3 *
+ * 2^26 (even) and 3 * 2^25 (odd), which covers the lazy add/sub
+ * results: column sums then stay below 2^63.
+ */
+typedef uint32_t limb_t;
+
+#define F25519_LIMBS  10
+
+#define MASK26  ((((uint32_t)1) << 26) - 1)
+#define MASK25  ((((uint32_t)1) << 25) - 1)
+
+static uint32_t load32(const uint8_t *x)
+{
+	return ((uint32_t)x[0]) | (((uint32_t)x[1]) << 8) |
+	       (((uint32_t)x[2]) << 16) | (((uint32_t)x[3]) << 24);
+}
+
+static void unpack(uint32_t *l, const uint8_t *x)
+{
+	l[0] = load32(x) & MASK26;
+	l[1] = (load32(x + 3) >> 2) & MASK25;
+	l[2] = (load32(x + 6) >> 3) & MASK26;
+	l[3] = (load32(x + 9) >> 5) & MASK25;
+	l[4] = (load32(x + 12) >> 6) & MASK26;
+	l[5] = load32(x + 16) & MASK25;
+	l[6] = (load32(x + 19) >> 1) & MASK26;
+	l[7] = (load32(x + 22) >> 3) & MASK25;
+	l[8] = (load32(x + 25) >> 4) & MASK26;
+	l[9] = load32(x + 28) >> 6;
+}
+
+/* Propagate carries, reducing with 2^255 = 19 mod p. Input limbs must
+ * be less than 2^31. On output, even limbs are less than 2^26 and odd
+ * limbs less than 2^25, except that l[1] may be slightly larger.
+ */
+static void carry(uint32_t *l)
+{
+	int i;
+
+	for (i = 0; i < 9; i += 2) {
+		l[i + 1] += l[i] >> 26;
+		l[i] &= MASK26;
+		if (i + 2 < 10)
+			l[i + 2] += l[i + 1] >> 25;
+		else
+			l[0] += (l[i + 1] >> 25) * 19;
+		l[i + 1] &= MASK25;
+	}
+
+	l[1] += l[0] >> 26;
+	l[0] &= MASK26;
+}
+
+static void pack(uint8_t *x, const uint32_t *in)
+{
+	uint32_t l[10];
+	uint32_t q;
+	uint64_t acc = 0;
+	int bits = 0;
+	int i;
+	int j = 0;
+
+	memcpy(l, in, sizeof(l));
+	carry(l);
+	carry(l);
+
+	/* The value is now less than 2p. Find out whether it's at least
+	 * p by checking whether adding 19 carries past bit 255.
+	 */
+	q = (l[0] + 19) >> 26;
+	for (i = 1; i < 10; i++)
+		q = (l[i] + q) >> ((i & 1) ? 25 : 26);
+
+	/* Subtract p if necessary, by adding 19 and dropping bit 255 */
+	l[0] += 19 * q;
+	for (i = 0; i < 9; i++) {
+		const int w = (i & 1) ? 25 : 26;
+
+		l[i + 1] += l[i] >> w;
+		l[i] &= (((uint32_t)1) << w) - 1;
+	}
+	l[9] &= MASK25;
+
+	for (i = 0; i < 10; i++) {
+		acc |= ((uint64_t)l[i]) << bits;
+		bits += (i & 1) ? 25 : 26;
+
+		while (bits >= 8) {
+			x[j++] = acc;
+			acc >>= 8;
+			bits -= 8;
+		}
+	}
+
+	x[j] = acc;
+}
+
+/* Fold a column-sum vector into reduced limbs. Column sums must be less
+ * than 2^63.
+ */
+static void carry_wide(uint32_t *r, uint64_t *t)
+{
+	int i;
+
+	for (i = 0; i < 9; i++) {
+		const int w = (i & 1) ? 25 : 26;
+
+		t[i + 1] += t[i] >> w;
+		r[i] = ((uint32_t)t[i]) & ((((uint32_t)1) << w) - 1);
+	}
+
+	t[0] = ((uint64_t)r[0]) + (t[9] >> 25) * 19;
+	r[9] = ((uint32_t)t[9]) & MASK25;
+	r[0] = ((uint32_t)t[0]) & MASK26;
+	r[1] += (uint32_t)(t[0] >> 26);
+}
+
+static void mul_limbs(uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+	/* Limb i is worth 2^ceil(25.5i). A product of two odd limbs lands
+	 * one bit below the column it's summed into, so it's doubled, and
+	 * anything at or above 2^255 is folded back as 19.
+	 */
+	const uint32_t a1_2 = a[1] << 1;
+	const uint32_t a3_2 = a[3] << 1;
+	const uint32_t a5_2 = a[5] << 1;
+	const uint32_t a7_2 = a[7] << 1;
+	const uint32_t a9_2 = a[9] << 1;
+	const uint32_t b1_19 = b[1] * 19;
+	const uint32_t b2_19 = b[2] * 19;
+	const uint32_t b3_19 = b[3] * 19;
+	const uint32_t b4_19 = b[4] * 19;
+	const uint32_t b5_19 = b[5] * 19;
+	const uint32_t b6_19 = b[6] * 19;
+	const uint32_t b7_19 = b[7] * 19;
+	const uint32_t b8_19 = b[8] * 19;
+	const uint32_t b9_19 = b[9] * 19;
+	uint64_t t[10];
+
+	t[0] = ((uint64_t)a[0]) * b[0] + ((uint64_t)a1_2) * b9_19 +
+	       ((uint64_t)a[2]) * b8_19 + ((uint64_t)a3_2) * b7_19 +
+	       ((uint64_t)a[4]) * b6_19 + ((uint64_t)a5_2) * b5_19 +
+	       ((uint64_t)a[6]) * b4_19 + ((uint64_t)a7_2) * b3_19 +
+	       ((uint64_t)a[8]) * b2_19 + ((uint64_t)a9_2) * b1_19;
+	t[1] = ((uint64_t)a[0]) * b[1] + ((uint64_t)a[1]) * b[0] +
+	       ((uint64_t)a[2]) * b9_19 + ((uint64_t)a[3]) * b8_19 +
+	       ((uint64_t)a[4]) * b7_19 + ((uint64_t)a[5]) * b6_19 +
+	       ((uint64_t)a[6]) * b5_19 + ((uint64_t)a[7]) * b4_19 +
+	       ((uint64_t)a[8]) * b3_19 + ((uint64_t)a[9]) * b2_19;
+	t[2] = ((uint64_t)a[0]) * b[2] + ((uint64_t)a1_2) * b[1] +
+	       ((uint64_t)a[2]) * b[0] + ((uint64_t)a3_2) * b9_19 +
+	       ((uint64_t)a[4]) * b8_19 + ((uint64_t)a5_2) * b7_19 +
+	       ((uint64_t)a[6]) * b6_19 + ((uint64_t)a7_2) * b5_19 +
+	       ((uint64_t)a[8]) * b4_19 + ((uint64_t)a9_2) * b3_19;
+	t[3] = ((uint64_t)a[0]) * b[3] + ((uint64_t)a[1]) * b[2] +
+	       ((uint64_t)a[2]) * b[1] + ((uint64_t)a[3]) * b[0] +
+	       ((uint64_t)a[4]) * b9_19 + ((uint64_t)a[5]) * b8_19 +
+	       ((uint64_t)a[6]) * b7_19 + ((uint64_t)a[7]) * b6_19 +
+	       ((uint64_t)a[8]) * b5_19 + ((uint64_t)a[9]) * b4_19;
+	t[4] = ((uint64_t)a[0]) * b[4] + ((uint64_t)a1_2) * b[3] +
+	       ((uint64_t)a[2]) * b[2] + ((uint64_t)a3_2) * b[1] +
+	       ((uint64_t)a[4]) * b[0] + ((uint64_t)a5_2) * b9_19 +
+	       ((uint64_t)a[6]) * b8_19 + ((uint64_t)a7_2) * b7_19 +
+	       ((uint64_t)a[8]) * b6_19 + ((uint64_t)a9_2) * b5_19;
+	t[5] = ((uint64_t)a[0]) * b[5] + ((uint64_t)a[1]) * b[4] +
+	       ((uint64_t)a[2]) * b[3] + ((uint64_t)a[3]) * b[2] +
+	       ((uint64_t)a[4]) * b[1] + ((uint64_t)a[5]) * b[0] +
+	       ((uint64_t)a[6]) * b9_19 + ((uint64_t)a[7]) * b8_19 +
+	       ((uint64_t)a[8]) * b7_19 + ((uint64_t)a[9]) * b6_19;
+	t[6] = ((uint64_t)a[0]) * b[6] + ((uint64_t)a1_2) * b[5] +
+	       ((uint64_t)a[2]) * b[4] + ((uint64_t)a3_2) * b[3] +
+	       ((uint64_t)a[4]) * b[2] + ((uint64_t)a5_2) * b[1] +
+	       ((uint64_t)a[6]) * b[0] + ((uint64_t)a7_2) * b9_19 +
+	       ((uint64_t)a[8]) * b8_19 + ((uint64_t)a9_2) * b7_19;
+	t[7] = ((uint64_t)a[0]) * b[7] + ((uint64_t)a[1]) * b[6] +
+	       ((uint64_t)a[2]) * b[5] + ((uint64_t)a[3]) * b[4] +
+	       ((uint64_t)a[4]) * b[3] + ((uint64_t)a[5]) * b[2] +
+	       ((uint64_t)a[6]) * b[1] + ((uint64_t)a[7]) * b[0] +
+	       ((uint64_t)a[8]) * b9_19 + ((uint64_t)a[9]) * b8_19;
+	t[8] = ((uint64_t)a[0]) * b[8] + ((uint64_t)a1_2) * b[7] +
+	       ((uint64_t)a[2]) * b[6] + ((uint64_t)a3_2) * b[5] +
+	       ((uint64_t)a[4]) * b[4] + ((uint64_t)a5_2) * b[3] +
+	       ((uint64_t)a[6]) * b[2] + ((uint64_t)a7_2) * b[1] +
+	       ((uint64_t)a[8]) * b[0] + ((uint64_t)a9_2) * b9_19;
+	t[9] = ((uint64_t)a[0]) * b[9] + ((uint64_t)a[1]) * b[8] +
+	       ((uint64_t)a[2]) * b[7] + ((uint64_t)a[3]) * b[6] +
+	       ((uint64_t)a[4]) * b[5] + ((uint64_t)a[5]) * b[4] +
+	       ((uint64_t)a[6]) * b[3] + ((uint64_t)a[7]) * b[2] +
+	       ((uint64_t)a[8]) * b[1] + ((uint64_t)a[9]) * b[0];
+
+	carry_wide(r, t);
+}
+
+static void sqr_limbs(uint32_t *r, const uint32_t *a)
+{
+	/* As mul_limbs(), but each cross product is computed only once
+	 * and doubled.
+	 */
+	const uint32_t a0_2 = a[0] << 1;
+	const uint32_t a1_2 = a[1] << 1;
+	const uint32_t a2_2 = a[2] << 1;
+	const uint32_t a3_2 = a[3] << 1;
+	const uint32_t a4_2 = a[4] << 1;
+	const uint32_t a5_2 = a[5] << 1;
+	const uint32_t a6_2 = a[6] << 1;
+	const uint32_t a7_2 = a[7] << 1;
+	const uint32_t a8_2 = a[8] << 1;
+	const uint32_t a9_2 = a[9] << 1;
+	const uint32_t a1_4 = a[1] << 2;
+	const uint32_t a3_4 = a[3] << 2;
+	const uint32_t a5_4 = a[5] << 2;
+	const uint32_t a7_4 = a[7] << 2;
+	const uint32_t a5_19 = a[5] * 19;
+	const uint32_t a6_19 = a[6] * 19;
+	const uint32_t a7_19 = a[7] * 19;
+	const uint32_t a8_19 = a[8] * 19;
+	const uint32_t a9_19 = a[9] * 19;
+	uint64_t t[10];
+
+	t[0] = ((uint64_t)a[0]) * a[0] + ((uint64_t)a1_4) * a9_19 +
+	       ((uint64_t)a2_2) * a8_19 + ((uint64_t)a3_4) * a7_19 +
+	       ((uint64_t)a4_2) * a6_19 + ((uint64_t)a5_2) * a5_19;
+	t[1] = ((uint64_t)a0_2) * a[1] + ((uint64_t)a2_2) * a9_19 +
+	       ((uint64_t)a3_2) * a8_19 + ((uint64_t)a4_2) * a7_19 +
+	       ((uint64_t)a5_2) * a6_19;
+	t[2] = ((uint64_t)a0_2) * a[2] + ((uint64_t)a1_2) * a[1] +
+	       ((uint64_t)a3_4) * a9_19 + ((uint64_t)a4_2) * a8_19 +
+	       ((uint64_t)a5_4) * a7_19 + ((uint64_t)a[6]) * a6_19;
+	t[3] = ((uint64_t)a0_2) * a[3] + ((uint64_t)a1_2) * a[2] +
+	       ((uint64_t)a4_2) * a9_19 + ((uint64_t)a5_2) * a8_19 +
+	       ((uint64_t)a6_2) * a7_19;
+	t[4] = ((uint64_t)a0_2) * a[4] + ((uint64_t)a1_4) * a[3] +
+	       ((uint64_t)a[2]) * a[2] + ((uint64_t)a5_4) * a9_19 +
+	       ((uint64_t)a6_2) * a8_19 + ((uint64_t)a7_2) * a7_19;
+	t[5] = ((uint64_t)a0_2) * a[5] + ((uint64_t)a1_2) * a[4] +
+	       ((uint64_t)a2_2) * a[3] + ((uint64_t)a6_2) * a9_19 +
+	       ((uint64_t)a7_2) * a8_19;
+	t[6] = ((uint64_t)a0_2) * a[6] + ((uint64_t)a1_4) * a[5] +
+	       ((uint64_t)a2_2) * a[4] + ((uint64_t)a3_2) * a[3] +
+	       ((uint64_t)a7_4) * a9_19 + ((uint64_t)a[8]) * a8_19;
+	t[7] = ((uint64_t)a0_2) * a[7] + ((uint64_t)a1_2) * a[6] +
+	       ((uint64_t)a2_2) * a[5] + ((uint64_t)a3_2) * a[4] +
+	       ((uint64_t)a8_2) * a9_19;
+	t[8] = ((uint64_t)a0_2) * a[8] + ((uint64_t)a1_4) * a[7] +
+	       ((uint64_t)a2_2) * a[6] + ((uint64_t)a3_4) * a[5] +
+	       ((uint64_t)a[4]) * a[4] + ((uint64_t)a9_2) * a9_19;
+	t[9] = ((uint64_t)a0_2) * a[9] + ((uint64_t)a1_2) * a[8] +
+	       ((uint64_t)a2_2) * a[7] + ((uint64_t)a3_2) * a[6] +
+	       ((uint64_t)a4_2) * a[5];
+
+	carry_wide(r, t);
+}
+
+static void mul_c_limbs(uint32_t *r, const uint32_t *a, uint32_t b)
+{
+	uint64_t t[10];
+	int i;
+
+	for (i = 0; i < 10; i++)
+		t[i] = ((uint64_t)a[i]) * b;
+
+	carry_wide(r, t);
+}
+
+/* 4p, limb by limb. Adding this before subtracting an unpacked or
+ * carried value (limbs less than 2^26) avoids underflow.
+ */
+static const uint32_t four_p[10] = {
+	0xfffffb4, 0x7fffffc, 0xffffffc, 0x7fffffc, 0xffffffc,
+	0x7fffffc, 0xffffffc, 0x7fffffc, 0xffffffc, 0x7fffffc
+};
+
+/* 2p, limb by limb. This is enough for carried values, and is used by
+ * the lazy subtraction to keep its results small.
+ */
+static const uint32_t two_p[10] = {
+	0x7ffffda, 0x3fffffe, 0x7fffffe, 0x3fffffe, 0x7fffffe,
+	0x3fffffe, 0x7fffffe, 0x3fffffe, 0x7fffffe, 0x3fffffe
+};
+
+#endif
+
+#if F25519_RADIX != 8
+
+/* Field operations shared by the limb backends. Results are left
+ * partially reduced by carry() or carry_wide(), so that they can be fed
+ * straight into further operations. The lazy variants skip even that,
+ * and rely on the headroom left in the multiplier.
+ */
+void f25519_fe_frombytes(struct f25519_fe *r, const uint8_t *x)
+{
+	unpack(r->v, x);
+	carry(r->v);
+}
+
+void f25519_fe_tobytes(uint8_t *x, const struct f25519_fe *a)
+{
+	pack(x, a->v);
+}
+
+void f25519_fe_load(struct f25519_fe *r, uint32_t c)
+{
+	uint8_t x[F25519_SIZE];
+
+	f25519_load(x, c);
+	unpack(r->v, x);
+}
+
+uint8_t f25519_fe_eq(const struct f25519_fe *a,
+		     const struct f25519_fe *b)
+{
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
+
+	pack(x, a->v);
+	pack(y, b->v);
+
+	return f25519_eq(x, y);
+}
+
+void f25519_fe_select(struct f25519_fe *dst,
+		      const struct f25519_fe *zero,
+		      const struct f25519_fe *one,
+		      uint8_t condition)
+{
+	const limb_t mask = -(limb_t)condition;
+	int i;
+
+	for (i = 0; i < F25519_LIMBS; i++)
+		dst->v[i] = zero->v[i] ^ (mask & (one->v[i] ^ zero->v[i]));
+}
+
+void f25519_fe_cswap(struct f25519_fe *a, struct f25519_fe *b,
+		     uint8_t condition)
+{
+	const limb_t mask = -(limb_t)condition;
+	int i;
+
+	for (i = 0; i < F25519_LIMBS; i++) {
+		const limb_t t = mask & (a->v[i] ^ b->v[i]);
+
+		a->v[i] ^= t;
+		b->v[i] ^= t;
+	}
+}
+
+void f25519_fe_add(struct f25519_fe *r,
+		   const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	int i;
+
+	for (i = 0; i < F25519_LIMBS; i++)
+		r->v[i] = a->v[i] + b->v[i];
+
+	carry(r->v);
+}
+
+void f25519_fe_sub(struct f25519_fe *r,
+		   const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	int i;
+
+	for (i = 0; i < F25519_LIMBS; i++)
+		r->v[i] = a->v[i] + four_p[i] - b->v[i];
+
+	carry(r->v);
+}
+
+void f25519_fe_neg(struct f25519_fe *r, const struct f25519_fe *a)
+{
+	int i;
+
+	for (i = 0; i < F25519_LIMBS; i++)
+		r->v[i] = four_p[i] - a->v[i];
+
+	carry(r->v);
+}
+
+void f25519_fe_add_lazy(struct f25519_fe *r,
+			const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	int i;
+
+	for (i = 0; i < F25519_LIMBS; i++)
+		r->v[i] = a->v[i] + b->v[i];
+}
+
+void f25519_fe_sub_lazy(struct f25519_fe *r,
+			const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	int i;
+
+	for (i = 0; i < F25519_LIMBS; i++)
+		r->v[i] = a->v[i] + two_p[i] - b->v[i];
+}
+
+void f25519_fe_mul(struct f25519_fe *r,
+		   const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	mul_limbs(r->v, a->v, b->v);
+}
+
+void f25519_fe_sqr(struct f25519_fe *r, const struct f25519_fe *a)
+{
+	sqr_limbs(r->v, a->v);
+}
+
+void f25519_fe_sqr_n(struct f25519_fe *r, const struct f25519_fe *a,
+		     int n)
+{
+	f25519_fe_copy(r, a);
+
+	while (n-- > 0)
+		sqr_limbs(r->v, r->v);
+}
+
+void f25519_fe_mul_c(struct f25519_fe *r, const struct f25519_fe *a,
+		     uint32_t b)
+{
+	mul_c_limbs(r->v, a->v, b);
+}
+
+/* Byte-oriented wrappers. Each unpacks its operands, performs a single
+ * operation and packs a fully reduced result.
+ */
+void f25519_add(uint8_t *r, const uint8_t *a, const uint8_t *b)
+{
+	struct f25519_fe x;
+	struct f25519_fe y;
+
+	unpack(x.v, a);
+	unpack(y.v, b);
+	f25519_fe_add(&x, &x, &y);
+	pack(r, x.v);
+}
+
+void f25519_sub(uint8_t *r, const uint8_t *a, const uint8_t *b)
+{
+	struct f25519_fe x;
+	struct f25519_fe y;
+
+	unpack(x.v, a);
+	unpack(y.v, b);
+	f25519_fe_sub(&x, &x, &y);
+	pack(r, x.v);
+}
+
+void f25519_neg(uint8_t *r, const uint8_t *a)
+{
+	struct f25519_fe x;
+
+	unpack(x.v, a);
+	f25519_fe_neg(&x, &x);
+	pack(r, x.v);
+}
+
+void f25519_mul__distinct(uint8_t *r, const uint8_t *a, const uint8_t *b)
+{
+	struct f25519_fe x;
+	struct f25519_fe y;
+
+	unpack(x.v, a);
+	unpack(y.v, b);
+	mul_limbs(x.v, x.v, y.v);
+	pack(r, x.v);
+}
+
+void f25519_mul(uint8_t *r, const uint8_t *a, const uint8_t *b)
+{
+	f25519_mul__distinct(r, a, b);
+}
+
+void f25519_sqr(uint8_t *r, const uint8_t *a)
+{
+	struct f25519_fe x;
+
+	unpack(x.v, a);
+	sqr_limbs(x.v, x.v);
+	pack(r, x.v);
+}
+
+void f25519_sqr_n(uint8_t *r, const uint8_t *a, int n)
+{
+	struct f25519_fe x;
+
+	unpack(x.v, a);
+	f25519_fe_sqr_n(&x, &x, n);
+	pack(r, x.v);
+}
+
+void f25519_mul_c(uint8_t *r, const uint8_t *a, uint32_t b)
+{
+	struct f25519_fe x;
+
+	unpack(x.v, a);
+	mul_c_limbs(x.v, x.v, b);
+	pack(r, x.v);
+}
+
+#else /* F25519_RADIX == 8 */
+
 void f25519_add(uint8_t *r, const uint8_t *a, const uint8_t *b)
 {
 	uint16_t c = 0;
@@ -191,6 +909,75 @@ void f25519_mul(uint8_t *r, const uint8_t *a, const uint8_t *b)
 	f25519_copy(r, tmp);
 }
 
+static void sqr__distinct(uint8_t *r, const uint8_t *a)
+{
+	uint32_t c = 0;
+	int i;
+
+	/* As f25519_mul__distinct(), but each cross product a[j]a[k] with
+	 * j < k is computed once and doubled.
+	 */
+	for (i = 0; i < F25519_SIZE; i++) {
+		uint32_t s = 0;
+		int j;
+
+		c >>= 8;
+
+		for (j = 0; j < i - j; j++)
+			s += ((uint32_t)a[j]) * ((uint32_t)a[i - j]);
+
+		if (!(i & 1))
+			c += ((uint32_t)a[i >> 1]) * ((uint32_t)a[i >> 1]);
+
+		c += s * 2;
+		s = 0;
+
+		for (j = i + 1; j < i + F25519_SIZE - j; j++)
+			s += ((uint32_t)a[j]) *
+			     ((uint32_t)a[i + F25519_SIZE - j]);
+
+		if (!(i & 1))
+			c += ((uint32_t)a[j]) * ((uint32_t)a[j]) * 38;
+
+		c += s * 76;
+		r[i] = c;
+	}
+
+	r[31] &= 127;
+	c = (c >> 7) * 19;
+
+	for (i = 0; i < F25519_SIZE; i++) {
+		c += r[i];
+		r[i] = c;
+		c >>= 8;
+	}
+}
+
+void f25519_sqr(uint8_t *r, const uint8_t *a)
+{
+	uint8_t tmp[F25519_SIZE];
+
+	sqr__distinct(tmp, a);
+	f25519_copy(r, tmp);
+}
+
+void f25519_sqr_n(uint8_t *r, const uint8_t *a, int n)
+{
+	uint8_t tmp[F25519_SIZE];
+
+	f25519_copy(r, a);
+
+	for (; n >= 2; n -= 2) {
+		sqr__distinct(tmp, r);
+		sqr__distinct(r, tmp);
+	}
+
+	if (n > 0) {
+		sqr__distinct(tmp, r);
+		f25519_copy(r, tmp);
+	}
+}
+
 void f25519_mul_c(uint8_t *r, const uint8_t *a, uint32_t b)
 {
 	uint32_t c = 0;
@@ -213,112 +1000,389 @@ void f25519_mul_c(uint8_t *r, const uint8_t *a, uint32_t b)
 	}
 }
 
-void f25519_inv__distinct(uint8_t *r, const uint8_t *x)
+
+/* In this backend, a struct f25519_fe is just the byte string, and
+ * the byte functions above do the work.
+ */
+void f25519_fe_frombytes(struct f25519_fe *r, const uint8_t *x)
+{
+	f25519_copy(r->v, x);
+	f25519_normalize(r->v);
+}
+
+void f25519_fe_tobytes(uint8_t *x, const struct f25519_fe *a)
+{
+	f25519_copy(x, a->v);
+	f25519_normalize(x);
+}
+
+void f25519_fe_load(struct f25519_fe *r, uint32_t c)
+{
+	f25519_load(r->v, c);
+}
+
+uint8_t f25519_fe_eq(const struct f25519_fe *a,
+		     const struct f25519_fe *b)
+{
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
+
+	f25519_fe_tobytes(x, a);
+	f25519_fe_tobytes(y, b);
+
+	return f25519_eq(x, y);
+}
+
+void f25519_fe_select(struct f25519_fe *dst,
+		      const struct f25519_fe *zero,
+		      const struct f25519_fe *one,
+		      uint8_t condition)
+{
+	f25519_select(dst->v, zero->v, one->v, condition);
+}
+
+void f25519_fe_cswap(struct f25519_fe *a, struct f25519_fe *b,
+		     uint8_t condition)
 {
-	uint8_t s[F25519_SIZE];
+	const uint8_t mask = -condition;
 	int i;
 
+	for (i = 0; i < F25519_SIZE; i++) {
+		const uint8_t t = mask & (a->v[i] ^ b->v[i]);
+
+		a->v[i] ^= t;
+		b->v[i] ^= t;
+	}
+}
+
+void f25519_fe_add(struct f25519_fe *r,
+		   const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	f25519_add(r->v, a->v, b->v);
+}
+
+void f25519_fe_sub(struct f25519_fe *r,
+		   const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	f25519_sub(r->v, a->v, b->v);
+}
+
+void f25519_fe_neg(struct f25519_fe *r, const struct f25519_fe *a)
+{
+	f25519_neg(r->v, a->v);
+}
+
+void f25519_fe_add_lazy(struct f25519_fe *r,
+			const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	f25519_add(r->v, a->v, b->v);
+}
+
+void f25519_fe_sub_lazy(struct f25519_fe *r,
+			const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	f25519_sub(r->v, a->v, b->v);
+}
+
+void f25519_fe_mul(struct f25519_fe *r,
+		   const struct f25519_fe *a, const struct f25519_fe *b)
+{
+	f25519_mul(r->v, a->v, b->v);
+}
+
+void f25519_fe_sqr(struct f25519_fe *r, const struct f25519_fe *a)
+{
+	f25519_sqr(r->v, a->v);
+}
+
+void f25519_fe_sqr_n(struct f25519_fe *r, const struct f25519_fe *a,
+		     int n)
+{
+	f25519_sqr_n(r->v, a->v, n);
+}
+
+void f25519_fe_mul_c(struct f25519_fe *r, const struct f25519_fe *a,
+		     uint32_t b)
+{
+	f25519_mul_c(r->v, a->v, b);
+}
+
+#endif
+
+/* Raise x to the power of 2^250-1, and also return x^11. Both are
+ * steps on the way to larger exponents of the form 2^k-c.
+ *
+ * Each run of ones is built by squaring a shorter run and multiplying
+ * it back in: x^(2^2k-1) = (x^(2^k-1))^(2^k) * x^(2^k-1). This takes
+ * 249 squarings and 10 multiplications.
+ */
+static void exp22501(struct f25519_fe *r, struct f25519_fe *x11,
+		     const struct f25519_fe *x)
+{
+	struct f25519_fe a;
+	struct f25519_fe b;
+	struct f25519_fe c;
+
+	/* x^11 */
+	f25519_fe_sqr(&a, x);
+	f25519_fe_sqr_n(&b, &a, 2);
+	f25519_fe_mul(&c, &b, x);
+	f25519_fe_mul(x11, &c, &a);
+
+	/* b = x^(2^5-1) = x^22 * x^9 */
+	f25519_fe_sqr(&a, x11);
+	f25519_fe_mul(&b, &a, &c);
+
+	/* c = x^(2^10-1) */
+	f25519_fe_sqr_n(&a, &b, 5);
+	f25519_fe_mul(&c, &a, &b);
+
+	/* b = x^(2^20-1) */
+	f25519_fe_sqr_n(&a, &c, 10);
+	f25519_fe_mul(&b, &a, &c);
+
+	/* r = x^(2^40-1) */
+	f25519_fe_sqr_n(&a, &b, 20);
+	f25519_fe_mul(r, &a, &b);
+
+	/* b = x^(2^50-1) */
+	f25519_fe_sqr_n(&a, r, 10);
+	f25519_fe_mul(&b, &a, &c);
+
+	/* c = x^(2^100-1) */
+	f25519_fe_sqr_n(&a, &b, 50);
+	f25519_fe_mul(&c, &a, &b);
+
+	/* r = x^(2^200-1) */
+	f25519_fe_sqr_n(&a, &c, 100);
+	f25519_fe_mul(r, &a, &c);
+
+	/* r = x^(2^250-1) */
+	f25519_fe_sqr_n(&a, r, 50);
+	f25519_fe_mul(r, &a, &b);
+}
+
+#if MODINV_SAFEGCD
+
+/* p = 2^255-19 in signed 62-bit limbs: -19 + 128 * 2^248 */
+static const struct modinv_modulus f25519_modulus = {
+	.v = {-19, 0, 0, 0, 128},
+	.inv62 = 0x39435e50d79435e5
+};
+
+void f25519_fe_inv(struct f25519_fe *r, const struct f25519_fe *x)
+{
+	uint8_t b[F25519_SIZE];
+
+	/* Bernstein-Yang inversion (see modinv.h) needs x < p, which
+	 * f25519_fe_tobytes() guarantees.
+	 */
+	f25519_fe_tobytes(b, x);
+	modinv(b, b, &f25519_modulus);
+	f25519_fe_frombytes(r, b);
+}
+
+#else
+
+void f25519_fe_inv(struct f25519_fe *r, const struct f25519_fe *x)
+{
+	struct f25519_fe s;
+	struct f25519_fe x11;
+
 	/* This is a prime field, so by Fermat's little theorem:
 	 *
 	 *     x^(p-1) = 1 mod p
 	 *
 	 * Therefore, raise to (p-2) = 2^255-21 to get a multiplicative
-	 * inverse.
-	 *
-	 * This is a 255-bit binary number with the digits:
+	 * inverse. We have:
 	 *
-	 *     11111111... 01011
+	 *     2^255-21 = (2^250-1) * 2^5 + 11
 	 *
-	 * We compute the result by the usual binary chain, but
-	 * alternate between keeping the accumulator in r and s, so as
-	 * to avoid copying temporaries.
+	 * The whole chain is 254 squarings and 11 multiplications.
 	 */
+	exp22501(&s, &x11, x);
+	f25519_fe_sqr_n(&s, &s, 5);
+	f25519_fe_mul(r, &s, &x11);
+}
 
-	/* 1 1 */
-	f25519_mul__distinct(s, x, x);
-	f25519_mul__distinct(r, s, x);
+#endif
 
-	/* 1 x 248 */
-	for (i = 0; i < 248; i++) {
-		f25519_mul__distinct(s, r, r);
-		f25519_mul__distinct(r, s, x);
-	}
+void f25519_inv__distinct(uint8_t *r, const uint8_t *x)
+{
+	struct f25519_fe a;
 
-	/* 0 */
-	f25519_mul__distinct(s, r, r);
+	f25519_fe_frombytes(&a, x);
+	f25519_fe_inv(&a, &a);
+	f25519_fe_tobytes(r, &a);
+}
 
-	/* 1 */
-	f25519_mul__distinct(r, s, s);
-	f25519_mul__distinct(s, r, x);
+void f25519_inv(uint8_t *r, const uint8_t *x)
+{
+	f25519_inv__distinct(r, x);
+}
 
-	/* 0 */
-	f25519_mul__distinct(r, s, s);
+/* Load x into r, replacing zero with one. Returns 1 if x was zero. */
+static uint8_t nonzero_or_one(uint8_t *r, const uint8_t *x)
+{
+	uint8_t z;
 
-	/* 1 */
-	f25519_mul__distinct(s, r, r);
-	f25519_mul__distinct(r, s, x);
+	f25519_copy(r, x);
+	f25519_normalize(r);
+	z = f25519_eq(r, f25519_zero);
+	f25519_select(r, x, f25519_one, z);
 
-	/* 1 */
-	f25519_mul__distinct(s, r, r);
-	f25519_mul__distinct(r, s, x);
+	return z;
 }
 
-void f25519_inv(uint8_t *r, const uint8_t *x)
+void f25519_inv_batch(uint8_t *out, const uint8_t *in, size_t n,
+		      uint8_t *scratch)
 {
-	uint8_t tmp[F25519_SIZE];
+	uint8_t acc[F25519_SIZE];
+	uint8_t x[F25519_SIZE];
+	size_t i;
 
-	f25519_inv__distinct(tmp, x);
-	f25519_copy(r, tmp);
-}
+	if (!n)
+		return;
 
-/* Raise x to the power of (p-5)/8 = 2^252-3, using s for temporary
- * storage.
- */
-static void exp2523(uint8_t *r, const uint8_t *x, uint8_t *s)
-{
-	int i;
+	/* Montgomery's trick. Form prefix products:
+	 *
+	 *     scratch[i] = in[0] * in[1] * ... * in[i]
+	 *
+	 * Zeros are replaced by one, so that they don't spoil the product
+	 * for the other elements.
+	 */
+	nonzero_or_one(scratch, in);
+
+	for (i = 1; i < n; i++) {
+		nonzero_or_one(x, in + i * F25519_SIZE);
+		f25519_mul__distinct(scratch + i * F25519_SIZE,
+				     scratch + (i - 1) * F25519_SIZE, x);
+	}
 
-	/* This number is a 252-bit number with the binary expansion:
+	/* Invert the full product, then peel one element off at a time:
 	 *
-	 *     111111... 01
+	 *     1/in[i] = (1/(in[0] ... in[i])) * (in[0] ... in[i-1])
 	 */
+	f25519_inv__distinct(acc, scratch + (n - 1) * F25519_SIZE);
 
-	/* 1 1 */
-	f25519_mul__distinct(r, x, x);
-	f25519_mul__distinct(s, r, x);
+	for (i = n - 1; i > 0; i--) {
+		uint8_t *s = scratch + i * F25519_SIZE;
+		const uint8_t z = nonzero_or_one(x, in + i * F25519_SIZE);
 
-	/* 1 x 248 */
-	for (i = 0; i < 248; i++) {
-		f25519_mul__distinct(r, s, s);
-		f25519_mul__distinct(s, r, x);
+		f25519_mul__distinct(s, acc, s - F25519_SIZE);
+		f25519_mul(acc, acc, x);
+		f25519_select(out + i * F25519_SIZE, s, f25519_zero, z);
 	}
 
-	/* 0 */
-	f25519_mul__distinct(r, s, s);
+	f25519_select(out, acc, f25519_zero, nonzero_or_one(x, in));
+}
+
+/* Raise x to the power of (p-5)/8 = 2^252-3 */
+static void exp2523(struct f25519_fe *r, const struct f25519_fe *x)
+{
+	struct f25519_fe s;
 
-	/* 1 */
-	f25519_mul__distinct(s, r, r);
-	f25519_mul__distinct(r, s, x);
+	/* This shares the inversion chain, since:
+	 *
+	 *     2^252-3 = (2^250-1) * 2^2 + 1
+	 *
+	 * The whole chain is 251 squarings and 11 multiplications. The
+	 * x^11 by-product is discarded into r.
+	 */
+	exp22501(&s, r, x);
+	f25519_fe_sqr_n(&s, &s, 2);
+	f25519_fe_mul(r, &s, x);
 }
 
-void f25519_sqrt(uint8_t *r, const uint8_t *a)
+void f25519_fe_sqrt(struct f25519_fe *r, const struct f25519_fe *a)
 {
-	uint8_t v[F25519_SIZE];
-	uint8_t i[F25519_SIZE];
-	uint8_t x[F25519_SIZE];
-	uint8_t y[F25519_SIZE];
+	struct f25519_fe v;
+	struct f25519_fe i;
+	struct f25519_fe x;
+	struct f25519_fe y;
 
 	/* v = (2a)^((p-5)/8) [x = 2a] */
-	f25519_mul_c(x, a, 2);
-	exp2523(v, x, y);
+	f25519_fe_mul_c(&x, a, 2);
+	exp2523(&v, &x);
 
 	/* i = 2av^2 - 1 */
-	f25519_mul__distinct(y, v, v);
-	f25519_mul__distinct(i, x, y);
-	f25519_load(y, 1);
-	f25519_sub(i, i, y);
+	f25519_fe_sqr(&y, &v);
+	f25519_fe_mul(&i, &x, &y);
+	f25519_fe_sub(&i, &i, &f25519_fe_one);
 
 	/* r = avi */
-	f25519_mul__distinct(x, v, a);
-	f25519_mul__distinct(r, x, i);
+	f25519_fe_mul(&x, &v, a);
+	f25519_fe_mul(r, &x, &i);
+}
+
+void f25519_sqrt(uint8_t *r, const uint8_t *a)
+{
+	struct f25519_fe x;
+
+	f25519_fe_frombytes(&x, a);
+	f25519_fe_sqrt(&x, &x);
+	f25519_fe_tobytes(r, &x);
+}
+
+/* sqrt(-1) = 2^((p-1)/4) =
+ *
+ *     196811613767075059568070793049885420154
+ *     46066515923890162744021073123829784752
+ */
+static const struct f25519_fe f25519_sqrtm1 = F25519_FE_INIT(
+	0xb0, 0xa0, 0x0e, 0x4a, 0x27, 0x1b, 0xee, 0xc4,
+	0x78, 0xe4, 0x2f, 0xad, 0x06, 0x18, 0x43, 0x2f,
+	0xa7, 0xd7, 0xfb, 0x3d, 0x99, 0x00, 0x4d, 0x2b,
+	0x0b, 0xdf, 0xc1, 0x4f, 0x80, 0x24, 0x83, 0x2b);
+
+uint8_t f25519_fe_sqrt_ratio(struct f25519_fe *r,
+			     const struct f25519_fe *u,
+			     const struct f25519_fe *v)
+{
+	struct f25519_fe v3;
+	struct f25519_fe t;
+	struct f25519_fe x;
+	struct f25519_fe c;
+	uint8_t pos;
+	uint8_t neg;
+
+	/* v3 = v^3, t = uv^7 */
+	f25519_fe_sqr(&t, v);
+	f25519_fe_mul(&v3, &t, v);
+	f25519_fe_sqr(&t, &v3);
+	f25519_fe_mul(&t, &t, v);
+	f25519_fe_mul(&t, &t, u);
+
+	/* x = uv^3 (uv^7)^((p-5)/8) */
+	exp2523(&x, &t);
+	f25519_fe_mul(&x, &x, &v3);
+	f25519_fe_mul(&x, &x, u);
+
+	/* If u/v is square, then vx^2 is either u or -u. In the second
+	 * case, x needs to be multiplied by sqrt(-1).
+	 */
+	f25519_fe_sqr(&c, &x);
+	f25519_fe_mul(&c, &c, v);
+	pos = f25519_fe_eq(&c, u);
+	f25519_fe_neg(&t, u);
+	neg = f25519_fe_eq(&c, &t);
+
+	f25519_fe_mul(&t, &x, &f25519_sqrtm1);
+	f25519_fe_select(r, &x, &t, neg);
+
+	return pos | neg;
+}
+
+uint8_t f25519_sqrt_ratio(uint8_t *r, const uint8_t *u, const uint8_t *v)
+{
+	struct f25519_fe x;
+	struct f25519_fe y;
+	uint8_t ok;
+
+	f25519_fe_frombytes(&x, u);
+	f25519_fe_frombytes(&y, v);
+	ok = f25519_fe_sqrt_ratio(&x, &x, &y);
+	f25519_fe_tobytes(r, &x);
+
+	return ok;
 }
@@ -8,7 +8,9 @@
 #define F25519_H_
 
 #include <stdint.h>
+#include <stddef.h>
 #include <string.h>
+#include <limits.h>
 
 /* Field elements are represented as little-endian byte strings. All
  * operations have timings which are independent of input data, so they
@@ -23,6 +25,132 @@
  */
 #define F25519_SIZE  32
 
+/* Arithmetic backend, selected at compile time:
+ *
+ *     8:  byte-at-a-time loops with 16/32-bit accumulators. This is the
+ *         smallest and most portable choice.
+ *
+ *     25: ten limbs of alternately 26 and 25 bits with 32x32->64
+ *         products. Suited to 32-bit cores.
+ *
+ *     51: five 51-bit limbs with 64x64->128 products. Requires a compiler
+ *         which provides unsigned __int128.
+ *
+ * If F25519_RADIX is not defined, the widest backend suited to the
+ * target is used. The byte representation and the function signatures
+ * below are the same for all backends, but the wider backends return
+ * fully reduced (normalized) results.
+ */
+#ifndef F25519_RADIX
+#if defined(__SIZEOF_INT128__)
+#define F25519_RADIX  51
+#elif UINT_MAX >= 0xffffffff
+#define F25519_RADIX  25
+#else
+#define F25519_RADIX  8
+#endif
+#endif
+
+#if F25519_RADIX != 8 && F25519_RADIX != 25 && F25519_RADIX != 51
+#error "F25519_RADIX must be 8, 25 or 51"
+#endif
+
+/* Field elements in the internal representation of the backend. Code
+ * which performs long chains of arithmetic (such as curve operations)
+ * should keep its values in this form, and convert to and from bytes
+ * only at the edges. Each of the byte-oriented functions below must
+ * unpack its operands and pack its result on every call.
+ *
+ * The contents are private to f25519.c. Values are kept only partially
+ * reduced, so compare them with f25519_fe_eq(), not memcmp().
+ *
+ * F25519_FE_INIT() gives a static initializer for a constant, from its
+ * 32-byte little-endian encoding. The constant must be less than p.
+ */
+#if F25519_RADIX == 51
+struct f25519_fe {
+	uint64_t v[5];
+};
+
+#define F25519_FE_INIT(b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, \
+	b12, b13, b14, b15, b16, b17, b18, b19, b20, b21, b22, b23, b24, \
+	b25, b26, b27, b28, b29, b30, b31) \
+	{ { \
+		((((uint64_t)(b0)) | ((uint64_t)(b1) << 8) | \
+		  ((uint64_t)(b2) << 16) | ((uint64_t)(b3) << 24) | \
+		  ((uint64_t)(b4) << 32) | ((uint64_t)(b5) << 40) | \
+		  ((uint64_t)(b6) << 48)) & 0x7ffffffffffffULL), \
+		((((uint64_t)(b6) >> 3) | ((uint64_t)(b7) << 5) | \
+		  ((uint64_t)(b8) << 13) | ((uint64_t)(b9) << 21) | \
+		  ((uint64_t)(b10) << 29) | ((uint64_t)(b11) << 37) | \
+		  ((uint64_t)(b12) << 45)) & 0x7ffffffffffffULL), \
+		((((uint64_t)(b12) >> 6) | ((uint64_t)(b13) << 2) | \
+		  ((uint64_t)(b14) << 10) | ((uint64_t)(b15) << 18) | \
+		  ((uint64_t)(b16) << 26) | ((uint64_t)(b17) << 34) | \
+		  ((uint64_t)(b18) << 42) | \
+		  ((uint64_t)(b19) << 50)) & 0x7ffffffffffffULL), \
+		((((uint64_t)(b19) >> 1) | ((uint64_t)(b20) << 7) | \
+		  ((uint64_t)(b21) << 15) | ((uint64_t)(b22) << 23) | \
+		  ((uint64_t)(b23) << 31) | ((uint64_t)(b24) << 39) | \
+		  ((uint64_t)(b25) << 47)) & 0x7ffffffffffffULL), \
+		((((uint64_t)(b25) >> 4) | ((uint64_t)(b26) << 4) | \
+		  ((uint64_t)(b27) << 12) | ((uint64_t)(b28) << 20) | \
+		  ((uint64_t)(b29) << 28) | ((uint64_t)(b30) << 36) | \
+		  ((uint64_t)(b31) << 44)) & 0x7ffffffffffffULL) \
+	} }
+#elif F25519_RADIX == 25
+struct f25519_fe {
+	uint32_t v[10];
+};
+
+#define F25519_FE_INIT(b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, \
+	b12, b13, b14, b15, b16, b17, b18, b19, b20, b21, b22, b23, b24, \
+	b25, b26, b27, b28, b29, b30, b31) \
+	{ { \
+		((((uint32_t)(b0)) | ((uint32_t)(b1) << 8) | \
+		  ((uint32_t)(b2) << 16) | \
+		  ((uint32_t)(b3) << 24)) & 0x3ffffff), \
+		((((uint32_t)(b3) >> 2) | ((uint32_t)(b4) << 6) | \
+		  ((uint32_t)(b5) << 14) | \
+		  ((uint32_t)(b6) << 22)) & 0x1ffffff), \
+		((((uint32_t)(b6) >> 3) | ((uint32_t)(b7) << 5) | \
+		  ((uint32_t)(b8) << 13) | \
+		  ((uint32_t)(b9) << 21)) & 0x3ffffff), \
+		((((uint32_t)(b9) >> 5) | ((uint32_t)(b10) << 3) | \
+		  ((uint32_t)(b11) << 11) | \
+		  ((uint32_t)(b12) << 19)) & 0x1ffffff), \
+		((((uint32_t)(b12) >> 6) | ((uint32_t)(b13) << 2) | \
+		  ((uint32_t)(b14) << 10) | \
+		  ((uint32_t)(b15) << 18)) & 0x3ffffff), \
+		((((uint32_t)(b16)) | ((uint32_t)(b17) << 8) | \
+		  ((uint32_t)(b18) << 16) | \
+		  ((uint32_t)(b19) << 24)) & 0x1ffffff), \
+		((((uint32_t)(b19) >> 1) | ((uint32_t)(b20) << 7) | \
+		  ((uint32_t)(b21) << 15) | \
+		  ((uint32_t)(b22) << 23)) & 0x3ffffff), \
+		((((uint32_t)(b22) >> 3) | ((uint32_t)(b23) << 5) | \
+		  ((uint32_t)(b24) << 13) | \
+		  ((uint32_t)(b25) << 21)) & 0x1ffffff), \
+		((((uint32_t)(b25) >> 4) | ((uint32_t)(b26) << 4) | \
+		  ((uint32_t)(b27) << 12) | \
+		  ((uint32_t)(b28) << 20)) & 0x3ffffff), \
+		((((uint32_t)(b28) >> 6) | ((uint32_t)(b29) << 2) | \
+		  ((uint32_t)(b30) << 10) | \
+		  ((uint32_t)(b31) << 18)) & 0x1ffffff) \
+	} }
+#else
+struct f25519_fe {
+	uint8_t v[F25519_SIZE];
+};
+
+#define F25519_FE_INIT(b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, \
+	b12, b13, b14, b15, b16, b17, b18, b19, b20, b21, b22, b23, b24, \
+	b25, b26, b27, b28, b29, b30, b31) \
+	{ { b0, b1, b2, b3, b4, b5, b6, b7, b8, b9, b10, b11, b12, b13, \
+	    b14, b15, b16, b17, b18, b19, b20, b21, b22, b23, b24, b25, \
+	    b26, b27, b28, b29, b30, b31 } }
+#endif
+
 /* Identity constants */
 extern const uint8_t f25519_zero[F25519_SIZE];
 extern const uint8_t f25519_one[F25519_SIZE];
@@ -67,6 +195,17 @@ void f25519_neg(uint8_t *r, const uint8_t *a);
 void f25519_mul(uint8_t *r, const uint8_t *a, const uint8_t *b);
 void f25519_mul__distinct(uint8_t *r, const uint8_t *a, const uint8_t *b);
 
+/* Square a field point. The two pointers are not required to be
+ * distinct. This is cheaper than f25519_mul(), because each cross
+ * product is computed only once.
+ */
+void f25519_sqr(uint8_t *r, const uint8_t *a);
+
+/* Square a field point n times in succession, computing a^(2^n). The
+ * two pointers are not required to be distinct.
+ */
+void f25519_sqr_n(uint8_t *r, const uint8_t *a, int n);
+
 /* Multiply a point by a small constant. The two pointers are not
  * required to be distinct.
  *
@@ -76,10 +215,24 @@ void f25519_mul_c(uint8_t *r, const uint8_t *a, uint32_t b);
 
 /* Take the reciprocal of a field point. The __distinct variant is used
  * when r is known to be in a different location to x.
+ *
+ * This uses the safegcd algorithm in modinv.h where it is available,
+ * and Fermat's little theorem otherwise.
  */
 void f25519_inv(uint8_t *r, const uint8_t *x);
 void f25519_inv__distinct(uint8_t *r, const uint8_t *x);
 
+/* Invert n field points at once, using one inversion and 3(n-1)
+ * multiplications. in and out are arrays of n consecutive elements
+ * (n * F25519_SIZE bytes), and may be the same array. scratch must
+ * have room for another n elements.
+ *
+ * As with f25519_inv(), zero elements are returned as zero, and the
+ * running time depends only on n.
+ */
+void f25519_inv_batch(uint8_t *out, const uint8_t *in, size_t n,
+		      uint8_t *scratch);
+
 /* Compute one of the square roots of the field element, if the element
  * is square. The other square is -r.
  *
@@ -89,4 +242,83 @@ void f25519_inv__distinct(uint8_t *r, const uint8_t *x);
  */
 void f25519_sqrt(uint8_t *r, const uint8_t *x);
 
+/* Compute a square root of u/v, with a single exponentiation and no
+ * separate inversion. Returns 1 if u/v is square (or u is zero), and 0
+ * otherwise, in which case r is not meaningful. The result is not
+ * required to have any particular sign. Pointers are not required to be
+ * distinct.
+ */
+uint8_t f25519_sqrt_ratio(uint8_t *r, const uint8_t *u, const uint8_t *v);
+
+/* Operations on struct f25519_fe values. These mirror the byte-oriented
+ * functions above, but skip the conversions. Pointer arguments are
+ * never required to be distinct. Results are not normalized, but
+ * f25519_fe_tobytes() always gives the fully reduced encoding.
+ */
+extern const struct f25519_fe f25519_fe_zero;
+extern const struct f25519_fe f25519_fe_one;
+
+/* Convert from and to bytes. Any 256-bit string is accepted as input */
+void f25519_fe_frombytes(struct f25519_fe *r, const uint8_t *x);
+void f25519_fe_tobytes(uint8_t *x, const struct f25519_fe *a);
+
+void f25519_fe_load(struct f25519_fe *r, uint32_t c);
+
+static inline void f25519_fe_copy(struct f25519_fe *r,
+				  const struct f25519_fe *a)
+{
+	*r = *a;
+}
+
+uint8_t f25519_fe_eq(const struct f25519_fe *a,
+		     const struct f25519_fe *b);
+void f25519_fe_select(struct f25519_fe *dst,
+		      const struct f25519_fe *zero,
+		      const struct f25519_fe *one,
+		      uint8_t condition);
+
+/* Conditional swap. If condition == 1, a and b are exchanged. If
+ * condition == 0, both are left as they are. As with select, any other
+ * value results in undefined behaviour.
+ */
+void f25519_fe_cswap(struct f25519_fe *a, struct f25519_fe *b,
+		     uint8_t condition);
+
+void f25519_fe_add(struct f25519_fe *r,
+		   const struct f25519_fe *a, const struct f25519_fe *b);
+void f25519_fe_sub(struct f25519_fe *r,
+		   const struct f25519_fe *a, const struct f25519_fe *b);
+void f25519_fe_neg(struct f25519_fe *r, const struct f25519_fe *a);
+
+/* Add/subtract without carrying. This saves a carry chain where the
+ * result is only going to be multiplied.
+ *
+ * The operands must be results of the other (non-lazy) operations,
+ * or constants. The result may be passed to f25519_fe_mul(),
+ * f25519_fe_sqr(), f25519_fe_mul_c(), f25519_fe_add() or
+ * f25519_fe_tobytes(). It must not be subtracted, negated, or used as
+ * an operand of another lazy operation.
+ *
+ * On the limb backends, operands have limbs below 2^51 (radix 51) or
+ * 2^26 (radix 25), and results stay below 2^53 or 3 * 2^26, which the
+ * multiplier accepts. The byte backend just adds or subtracts.
+ */
+void f25519_fe_add_lazy(struct f25519_fe *r,
+			const struct f25519_fe *a, const struct f25519_fe *b);
+void f25519_fe_sub_lazy(struct f25519_fe *r,
+			const struct f25519_fe *a, const struct f25519_fe *b);
+
+void f25519_fe_mul(struct f25519_fe *r,
+		   const struct f25519_fe *a, const struct f25519_fe *b);
+void f25519_fe_sqr(struct f25519_fe *r, const struct f25519_fe *a);
+void f25519_fe_sqr_n(struct f25519_fe *r, const struct f25519_fe *a,
+		     int n);
+void f25519_fe_mul_c(struct f25519_fe *r, const struct f25519_fe *a,
+		     uint32_t b);
+void f25519_fe_inv(struct f25519_fe *r, const struct f25519_fe *x);
+void f25519_fe_sqrt(struct f25519_fe *r, const struct f25519_fe *a);
+uint8_t f25519_fe_sqrt_ratio(struct f25519_fe *r,
+			     const struct f25519_fe *u,
+			     const struct f25519_fe *v);
+
 #endif
@@ -5,6 +5,7 @@
  */
 
 #include "fprime.h"
+#include "modinv.h"
 
 const uint8_t fprime_zero[FPRIME_SIZE] = {0};
 const uint8_t fprime_one[FPRIME_SIZE] = {1};
@@ -185,6 +186,18 @@ void fprime_mul(uint8_t *r, const uint8_t *a, const uint8_t *b,
 	}
 }
 
+#if MODINV_SAFEGCD
+
+void fprime_inv(uint8_t *r, const uint8_t *a, const uint8_t *modulus)
+{
+	struct modinv_modulus m;
+
+	modinv_init(&m, modulus);
+	modinv(r, a, &m);
+}
+
+#else
+
 void fprime_inv(uint8_t *r, const uint8_t *a, const uint8_t *modulus)
 {
 	uint8_t pm2[FPRIME_SIZE];
@@ -213,3 +226,5 @@ void fprime_inv(uint8_t *r, const uint8_t *a, const uint8_t *modulus)
 			fprime_copy(r, r2);
 	}
 }
+
+#endif
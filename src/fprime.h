@@ -64,7 +64,11 @@ void fprime_sub(uint8_t *r, const uint8_t *a, const uint8_t *modulus);
 void fprime_mul(uint8_t *r, const uint8_t *a, const uint8_t *b,
 		const uint8_t *modulus);
 
-/* Compute multiplicative inverse. r must be distinct from a */
+/* Compute multiplicative inverse. r must be distinct from a.
+ *
+ * Where available, this uses the safegcd algorithm in modinv.h, which
+ * requires an odd modulus. Otherwise, a is raised to the power p-2.
+ */
 void fprime_inv(uint8_t *r, const uint8_t *a, const uint8_t *modulus);
 
 #endif
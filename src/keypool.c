@@ -0,0 +1,206 @@
+/* Background pool of ephemeral Curve25519 keypairs
+ *
+ * This file is in the public domain.
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include "keypool.h"
+
+/* Each slot carries a sequence number, which says whose turn it is:
+ *
+ *     seq == pos          empty, and may be filled as position pos
+ *     seq == pos + 1      full, and may be taken as position pos
+ *
+ * Taking a pair from position pos hands the slot back for position
+ * pos + depth. There is only one producer (the worker), so only the
+ * consumers need to race for positions. Consumers may finish out of
+ * order, so the worker must still check the sequence number of the
+ * slot it's about to fill: a slot handed back elsewhere in the ring
+ * doesn't mean that this one is free yet.
+ *
+ * For more information, see:
+ *
+ *     Vyukov, D. "Bounded MPMC queue". 1024cores.net.
+ */
+struct keypool_slot {
+	size_t			seq;
+	struct keypool_pair	pair;
+};
+
+struct keypool {
+	struct keypool_slot	*slots;
+	size_t			mask;
+
+	/* Next position to fill (worker only) and to take */
+	size_t			head;
+	size_t			tail;
+
+	/* Posted once for every slot handed back. The worker sleeps on
+	 * this while its next slot is still in use.
+	 */
+	sem_t			space;
+	pthread_t		worker;
+	int			stop;
+
+	/* Set when the worker has stopped because rng failed */
+	int			failed;
+
+	int			(*rng)(void *arg, uint8_t *buf, size_t len);
+	void			*arg;
+};
+
+static void wipe(void *buf, size_t len)
+{
+	volatile uint8_t *b = buf;
+
+	while (len--)
+		*b++ = 0;
+}
+
+static int generate(const struct keypool *p, struct keypool_pair *kp)
+{
+	if (p->rng(p->arg, kp->secret, sizeof(kp->secret)))
+		return -1;
+
+	c25519_prepare(kp->secret);
+	c25519_keygen(kp->pub, kp->secret);
+	return 0;
+}
+
+static void *worker(void *arg)
+{
+	struct keypool *p = arg;
+
+	for (;;) {
+		struct keypool_slot *s = &p->slots[p->head & p->mask];
+
+		if (__atomic_load_n(&p->stop, __ATOMIC_ACQUIRE))
+			break;
+
+		/* Wait for this slot to be handed back. Wakeups for other
+		 * slots just bring us round the loop again.
+		 */
+		if (__atomic_load_n(&s->seq, __ATOMIC_ACQUIRE) != p->head) {
+			while (sem_wait(&p->space) < 0 && errno == EINTR)
+				;
+			continue;
+		}
+
+		/* If the generator fails, stop filling and let
+		 * keypool_pop() report it once the pool runs dry.
+		 */
+		if (generate(p, &s->pair) < 0) {
+			wipe(&s->pair, sizeof(s->pair));
+			__atomic_store_n(&p->failed, 1, __ATOMIC_RELEASE);
+			break;
+		}
+
+		__atomic_store_n(&s->seq, p->head + 1, __ATOMIC_RELEASE);
+		p->head++;
+	}
+
+	return NULL;
+}
+
+struct keypool *keypool_create(size_t depth,
+			       int (*rng)(void *arg, uint8_t *buf,
+					  size_t len),
+			       void *arg)
+{
+	struct keypool *p;
+	size_t n = 2;
+	size_t i;
+
+	while (n < depth)
+		n <<= 1;
+
+	p = calloc(1, sizeof(*p));
+	if (!p)
+		return NULL;
+
+	p->slots = calloc(n, sizeof(p->slots[0]));
+	if (!p->slots)
+		goto fail_slots;
+
+	for (i = 0; i < n; i++)
+		p->slots[i].seq = i;
+
+	p->mask = n - 1;
+	p->rng = rng;
+	p->arg = arg;
+
+	if (sem_init(&p->space, 0, n) < 0)
+		goto fail_sem;
+
+	if (pthread_create(&p->worker, NULL, worker, p))
+		goto fail_thread;
+
+	return p;
+
+fail_thread:
+	sem_destroy(&p->space);
+fail_sem:
+	free(p->slots);
+fail_slots:
+	free(p);
+	return NULL;
+}
+
+void keypool_destroy(struct keypool *p)
+{
+	__atomic_store_n(&p->stop, 1, __ATOMIC_RELEASE);
+	sem_post(&p->space);
+	pthread_join(p->worker, NULL);
+
+	wipe(p->slots, (p->mask + 1) * sizeof(p->slots[0]));
+	sem_destroy(&p->space);
+	free(p->slots);
+	free(p);
+}
+
+int keypool_pop(struct keypool *p, struct keypool_pair *kp)
+{
+	size_t pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+	struct keypool_slot *s;
+
+	for (;;) {
+		size_t seq;
+
+		s = &p->slots[pos & p->mask];
+		seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+
+		if (seq == pos + 1) {
+			/* Full: try to claim it. On failure, pos is
+			 * updated to the current tail.
+			 */
+			if (__atomic_compare_exchange_n(&p->tail, &pos,
+					pos + 1, 1, __ATOMIC_RELAXED,
+					__ATOMIC_RELAXED))
+				break;
+		} else if ((ptrdiff_t)(seq - pos) <= 0) {
+			/* Empty, or not yet handed back from the last lap:
+			 * do the work here instead, unless the worker has
+			 * given up.
+			 */
+			if (__atomic_load_n(&p->failed, __ATOMIC_ACQUIRE))
+				return -2;
+
+			return generate(p, kp);
+		} else {
+			/* Another consumer took it first */
+			pos = __atomic_load_n(&p->tail, __ATOMIC_RELAXED);
+		}
+	}
+
+	*kp = s->pair;
+	wipe(&s->pair, sizeof(s->pair));
+
+	/* Hand the slot back for the next lap, and wake the worker */
+	__atomic_store_n(&s->seq, pos + p->mask + 1, __ATOMIC_RELEASE);
+	sem_post(&p->space);
+
+	return 0;
+}
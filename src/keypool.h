@@ -0,0 +1,61 @@
+/* Background pool of ephemeral Curve25519 keypairs
+ *
+ * This file is in the public domain.
+ */
+
+#ifndef KEYPOOL_H_
+#define KEYPOOL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "c25519.h"
+
+/* A worker thread keeps up to a fixed number of keypairs ready, so that
+ * taking one costs a queue operation rather than a scalar multiply.
+ * The queue is a bounded lock-free ring (Vyukov's MPMC design), so any
+ * number of threads may call keypool_pop() at once.
+ *
+ * This module needs POSIX threads and semaphores, and a C compiler
+ * with GCC-style __atomic builtins. Link with -pthread.
+ */
+struct keypool;
+
+struct keypool_pair {
+	uint8_t  secret[C25519_EXPONENT_SIZE];
+	uint8_t  pub[F25519_SIZE];
+};
+
+/* Create a pool and start its worker. depth is rounded up to a power
+ * of two (at least 2). Returns NULL if memory or the thread could not
+ * be obtained.
+ *
+ * rng is the random number source. It must fill buf with len secure
+ * random bytes and return 0, or return non-zero on failure. It's
+ * called from the worker thread, and also from any thread that finds
+ * the pool empty, so it must be safe to call concurrently.
+ */
+struct keypool *keypool_create(size_t depth,
+			       int (*rng)(void *arg, uint8_t *buf,
+					  size_t len),
+			       void *arg);
+
+/* Stop the worker, wipe any unused secrets and free the pool. No
+ * other thread may be using it.
+ */
+void keypool_destroy(struct keypool *p);
+
+/* Take a keypair. If none is ready, one is generated on the calling
+ * thread instead. Returns 0 on success, or -1 if the random number
+ * source failed on the calling thread.
+ *
+ * If rng fails in the worker, the worker stops for good: the pairs
+ * already made can still be taken, after which this returns -2
+ * without calling rng. The pool should then be destroyed, and a new
+ * one created once the random number source is working again.
+ *
+ * The secret is clamped with c25519_prepare(), and pub is its public
+ * key, as c25519_keygen() gives it.
+ */
+int keypool_pop(struct keypool *p, struct keypool_pair *kp);
+
+#endif
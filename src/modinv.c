@@ -0,0 +1,282 @@
+/* Constant-time modular inversion
+ *
+ * This file is in the public domain.
+ */
+
+#include "modinv.h"
+
+#define M62  (UINT64_MAX >> 2)
+
+static uint64_t load64(const uint8_t *x)
+{
+	uint64_t r = 0;
+	int i;
+
+	for (i = 7; i >= 0; i--)
+		r = (r << 8) | x[i];
+
+	return r;
+}
+
+/* Convert bytes to non-negative 62-bit limbs */
+static void unpack(int64_t *v, const uint8_t *x)
+{
+	const uint64_t w0 = load64(x);
+	const uint64_t w1 = load64(x + 8);
+	const uint64_t w2 = load64(x + 16);
+	const uint64_t w3 = load64(x + 24);
+
+	v[0] = w0 & M62;
+	v[1] = ((w0 >> 62) | (w1 << 2)) & M62;
+	v[2] = ((w1 >> 60) | (w2 << 4)) & M62;
+	v[3] = ((w2 >> 58) | (w3 << 6)) & M62;
+	v[4] = w3 >> 56;
+}
+
+void modinv_init(struct modinv_modulus *m, const uint8_t *modulus)
+{
+	const uint64_t m0 = load64(modulus);
+	uint64_t x = m0;
+	int i;
+
+	unpack(m->v, modulus);
+
+	/* Newton's iteration for m^-1 mod 2^64. An odd number is its own
+	 * inverse mod 8, and each step doubles the number of correct bits.
+	 */
+	for (i = 0; i < 5; i++)
+		x *= 2 - m0 * x;
+
+	m->inv62 = x & M62;
+}
+
+#if MODINV_SAFEGCD
+
+__extension__ typedef __int128 int128_t;
+
+static void store64(uint8_t *x, uint64_t c)
+{
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		x[i] = c;
+		c >>= 8;
+	}
+}
+
+/* Convert non-negative 62-bit limbs back to bytes */
+static void pack(uint8_t *x, const int64_t *v)
+{
+	const uint64_t v0 = v[0];
+	const uint64_t v1 = v[1];
+	const uint64_t v2 = v[2];
+	const uint64_t v3 = v[3];
+	const uint64_t v4 = v[4];
+
+	store64(x, v0 | (v1 << 62));
+	store64(x + 8, (v1 >> 2) | (v2 << 60));
+	store64(x + 16, (v2 >> 4) | (v3 << 58));
+	store64(x + 24, (v3 >> 6) | (v4 << 56));
+}
+
+/* Transition matrix for a batch of division steps, scaled by 2^62 */
+struct trans2x2 {
+	int64_t u, v, q, r;
+};
+
+/* Perform 59 division steps on the low bits of f and g, which are
+ * enough to determine the first 59 steps on the full values. Returns
+ * the updated zeta, where zeta = -(delta + 1/2).
+ *
+ * All branches are replaced by masks. The volatile qualifiers stop the
+ * compiler from turning the masks back into branches.
+ */
+static int64_t divsteps_59(int64_t zeta, uint64_t f0, uint64_t g0,
+			   struct trans2x2 *t)
+{
+	/* The matrix starts as the identity scaled by 2^3, so that after
+	 * 59 steps it is scaled by 2^62. Elements are signed values in
+	 * [-2^62, 2^62], held unsigned so that left shifts are defined.
+	 */
+	uint64_t u = 8, v = 0, q = 0, r = 8;
+	volatile uint64_t c1, c2;
+	uint64_t mask1, mask2, f = f0, g = g0, x, y, z;
+	int i;
+
+	for (i = 3; i < 62; i++) {
+		/* Masks for (zeta < 0) and (g odd) */
+		c1 = zeta >> 63;
+		mask1 = c1;
+		c2 = g & 1;
+		mask2 = -c2;
+
+		/* x, y, z = f, u, v, negated if zeta < 0 */
+		x = (f ^ mask1) - mask1;
+		y = (u ^ mask1) - mask1;
+		z = (v ^ mask1) - mask1;
+
+		/* If g is odd, add them to g, q, r */
+		g += x & mask2;
+		q += y & mask2;
+		r += z & mask2;
+
+		/* If both, swap roles: zeta becomes -zeta-2, and f, u, v
+		 * take on the old g, q, r. Otherwise zeta decreases.
+		 */
+		mask1 &= mask2;
+		zeta = (zeta ^ (int64_t)mask1) - 1;
+		f += g & mask1;
+		u += q & mask1;
+		v += r & mask1;
+
+		g >>= 1;
+		u <<= 1;
+		v <<= 1;
+	}
+
+	t->u = (int64_t)u;
+	t->v = (int64_t)v;
+	t->q = (int64_t)q;
+	t->r = (int64_t)r;
+
+	return zeta;
+}
+
+/* Apply the transition matrix to (d, e), which are kept in the range
+ * (-2m, m). Multiples of m are added to make the result divisible by
+ * 2^62, and then the division is done by shifting limbs down.
+ */
+static void update_de(int64_t *d, int64_t *e, const struct trans2x2 *t,
+		      const struct modinv_modulus *m)
+{
+	const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+	const int64_t sd = d[4] >> 63;
+	const int64_t se = e[4] >> 63;
+	int64_t md = (u & sd) + (v & se);
+	int64_t me = (q & sd) + (r & se);
+	int128_t cd;
+	int128_t ce;
+	int i;
+
+	cd = (int128_t)u * d[0] + (int128_t)v * e[0];
+	ce = (int128_t)q * d[0] + (int128_t)r * e[0];
+
+	/* Choose md, me so that the bottom 62 bits become zero */
+	md -= (m->inv62 * (uint64_t)cd + md) & M62;
+	me -= (m->inv62 * (uint64_t)ce + me) & M62;
+
+	cd += (int128_t)m->v[0] * md;
+	ce += (int128_t)m->v[0] * me;
+	cd >>= 62;
+	ce >>= 62;
+
+	for (i = 1; i < 5; i++) {
+		cd += (int128_t)u * d[i] + (int128_t)v * e[i] +
+		      (int128_t)m->v[i] * md;
+		ce += (int128_t)q * d[i] + (int128_t)r * e[i] +
+		      (int128_t)m->v[i] * me;
+		d[i - 1] = (int64_t)((uint64_t)cd & M62);
+		e[i - 1] = (int64_t)((uint64_t)ce & M62);
+		cd >>= 62;
+		ce >>= 62;
+	}
+
+	d[4] = (int64_t)cd;
+	e[4] = (int64_t)ce;
+}
+
+/* Apply the transition matrix to (f, g). The bottom 62 bits of the
+ * result are zero by construction.
+ */
+static void update_fg(int64_t *f, int64_t *g, const struct trans2x2 *t)
+{
+	const int64_t u = t->u, v = t->v, q = t->q, r = t->r;
+	int128_t cf;
+	int128_t cg;
+	int i;
+
+	cf = (int128_t)u * f[0] + (int128_t)v * g[0];
+	cg = (int128_t)q * f[0] + (int128_t)r * g[0];
+	cf >>= 62;
+	cg >>= 62;
+
+	for (i = 1; i < 5; i++) {
+		cf += (int128_t)u * f[i] + (int128_t)v * g[i];
+		cg += (int128_t)q * f[i] + (int128_t)r * g[i];
+		f[i - 1] = (int64_t)((uint64_t)cf & M62);
+		g[i - 1] = (int64_t)((uint64_t)cg & M62);
+		cf >>= 62;
+		cg >>= 62;
+	}
+
+	f[4] = (int64_t)cf;
+	g[4] = (int64_t)cg;
+}
+
+/* Propagate carries so that limbs 0..3 are in [0, 2^62) */
+static void carry(int64_t *r)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		r[i + 1] += r[i] >> 62;
+		r[i] &= (int64_t)M62;
+	}
+}
+
+/* Bring r from (-2m, m) to [0, m), negating it first if sign < 0 */
+static void normalize(int64_t *r, int64_t sign,
+		      const struct modinv_modulus *m)
+{
+	volatile int64_t cond_add;
+	volatile int64_t cond_negate;
+	int i;
+
+	cond_add = r[4] >> 63;
+	for (i = 0; i < 5; i++)
+		r[i] += m->v[i] & cond_add;
+
+	cond_negate = sign >> 63;
+	for (i = 0; i < 5; i++)
+		r[i] = (r[i] ^ cond_negate) - cond_negate;
+
+	carry(r);
+
+	cond_add = r[4] >> 63;
+	for (i = 0; i < 5; i++)
+		r[i] += m->v[i] & cond_add;
+
+	carry(r);
+}
+
+void modinv(uint8_t *r, const uint8_t *x, const struct modinv_modulus *m)
+{
+	int64_t d[5] = {0};
+	int64_t e[5] = {1};
+	int64_t f[5];
+	int64_t g[5];
+	int64_t zeta = -1;
+	int i;
+
+	for (i = 0; i < 5; i++)
+		f[i] = m->v[i];
+
+	unpack(g, x);
+
+	/* 590 division steps are enough for any pair of 256-bit inputs.
+	 * Afterwards g is zero, f is +/-1 (unless x was zero), and d is
+	 * +/- the inverse.
+	 */
+	for (i = 0; i < 10; i++) {
+		struct trans2x2 t;
+
+		zeta = divsteps_59(zeta, f[0], g[0], &t);
+		update_de(d, e, &t, m);
+		update_fg(f, g, &t);
+	}
+
+	normalize(d, f[4], m);
+	pack(r, d);
+}
+
+#endif
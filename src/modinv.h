@@ -0,0 +1,57 @@
+/* Constant-time modular inversion
+ *
+ * This file is in the public domain.
+ */
+
+#ifndef MODINV_H_
+#define MODINV_H_
+
+#include <stdint.h>
+
+/* Inversion modulo an odd number m < 2^256 by Bernstein and Yang's
+ * "safegcd" algorithm. The time taken is independent of the value
+ * being inverted, and is several times less than that of raising it to
+ * the power m-2.
+ *
+ * The implementation follows the constant-time variant used in
+ * libsecp256k1: 10 batches of 59 division steps, each batch applied to
+ * signed 62-bit limbs as a 2x2 transition matrix. This requires
+ * 64x64->128 products, so it is available only where the compiler
+ * provides __int128. Define MODINV_SAFEGCD to 0 to leave it out, in
+ * which case f25519 and fprime fall back to Fermat inversion.
+ *
+ * For more information, see:
+ *
+ *     Bernstein, D.J. & Yang, B.Y. (2019) "Fast constant-time gcd
+ *     computation and modular inversion". IACR Transactions on
+ *     Cryptographic Hardware and Embedded Systems, 2019(3), pp. 340-398.
+ */
+#ifndef MODINV_SAFEGCD
+#if defined(__SIZEOF_INT128__)
+#define MODINV_SAFEGCD  1
+#else
+#define MODINV_SAFEGCD  0
+#endif
+#endif
+
+#define MODINV_SIZE  32
+
+/* Modulus, in signed 62-bit limbs, and its inverse mod 2^62 */
+struct modinv_modulus {
+	int64_t   v[5];
+	uint64_t  inv62;
+};
+
+/* Prepare an odd modulus, given as MODINV_SIZE little-endian bytes.
+ * This takes time which depends on the modulus.
+ */
+void modinv_init(struct modinv_modulus *m, const uint8_t *modulus);
+
+#if MODINV_SAFEGCD
+/* Compute r = x^-1 mod m, where x < m. Zero is returned as zero. The
+ * result is fully reduced. r and x are not required to be distinct.
+ */
+void modinv(uint8_t *r, const uint8_t *x, const struct modinv_modulus *m);
+#endif
+
+#endif
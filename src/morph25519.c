@@ -66,34 +66,26 @@ uint8_t morph25519_ey2ex(uint8_t *x, const uint8_t *y, int parity)
 	uint8_t a[F25519_SIZE];
 	uint8_t b[F25519_SIZE];
 	uint8_t c[F25519_SIZE];
+	uint8_t ok;
 
 	/* Compute c = y^2 */
-	f25519_mul__distinct(c, y, y);
+	f25519_sqr(c, y);
 
-	/* Compute b = (1+dy^2)^-1 */
-	f25519_mul__distinct(b, c, d);
-	f25519_add(a, b, f25519_one);
-	f25519_inv__distinct(b, a);
+	/* Compute b = 1+dy^2 */
+	f25519_mul__distinct(a, c, d);
+	f25519_add(b, a, f25519_one);
 
 	/* Compute a = y^2-1 */
 	f25519_sub(a, c, f25519_one);
 
-	/* Compute c = a*b = (y^2-1)/(1+dy^2) */
-	f25519_mul__distinct(c, a, b);
-
-	/* Compute a, b = +/-sqrt(c), if c is square */
-	f25519_sqrt(a, c);
+	/* Compute a, b = +/-sqrt(a/b), if a/b is square */
+	ok = f25519_sqrt_ratio(a, a, b);
 	f25519_neg(b, a);
 
 	/* Select one of them, based on the parity bit */
 	f25519_select(x, a, b, (a[0] ^ parity) & 1);
 
-	/* Verify that x^2 = c */
-	f25519_mul__distinct(a, x, x);
-	f25519_normalize(a);
-	f25519_normalize(c);
-
-	return f25519_eq(a, c);
+	return ok;
 }
 
 uint8_t morph25519_wx2wy(uint8_t *wy, const uint8_t *wx, int sign)
@@ -117,7 +109,7 @@ uint8_t morph25519_wx2wy(uint8_t *wy, const uint8_t *wx, int sign)
 	uint8_t T3[F25519_SIZE];
 
 	/* Compute T2 = x^3 */
-	f25519_mul__distinct(T1, wx, wx);
+	f25519_sqr(T1, wx);
 	f25519_mul__distinct(T2, T1, wx);
 
 	/* Compute T1 = ax */
@@ -138,7 +130,7 @@ uint8_t morph25519_wx2wy(uint8_t *wy, const uint8_t *wx, int sign)
 	f25519_select(wy, T2, T3, sign);
 
 	/* Verify that T2 = wy^2 == T1 */
-	f25519_mul__distinct(T2, wy, wy);
+	f25519_sqr(T2, wy);
 	f25519_normalize(T1);
 	f25519_normalize(T2);
 
@@ -160,7 +152,7 @@ void morph25519_montgomery_recovery(
 	f25519_mul(v1, xP, ZQ);   // 1 v1 ← xP · ZQ 	1M
 	f25519_add(v2, XQ, v1);	  // 2 v2 ← XQ + v1 	1a
 	f25519_sub(v3, XQ, v1);	  // 3 v3 ← XQ − v1 	1s
-	f25519_mul(v3, v3, v3);	  // 4 v3 ← v3^2 		1S
+	f25519_sqr(v3, v3);		  // 4 v3 ← v3^2 		1S
 	f25519_mul(v3, v3, xD);	  // 5 v3 ← v3 · X⊕ 	1M
 	f25519_mul_c(v1, ZQ, A2); // 6 v1 ← 2A · ZQ 	1c
 	f25519_add(v2, v2, v1);	  // 7 v2 ← v2 + v1 	1a
@@ -772,6 +772,171 @@ static void test_vector_xy(const struct test_vector *v)
 	printf("\n");
 }
 
+/* The sign of y must survive recovery: (2^254 + 40) * base */
+static void test_xy_sign(void)
+{
+	static const uint8_t expect_y[F25519_SIZE] = {
+		0x3c, 0x8e, 0xa2, 0x49, 0x37, 0x56, 0x90, 0x7b,
+		0x29, 0xbe, 0x25, 0x63, 0x66, 0x08, 0x3e, 0x2b,
+		0xc9, 0xe1, 0x36, 0xf1, 0x61, 0xb4, 0xd3, 0x46,
+		0x5d, 0xa9, 0x2c, 0x9f, 0xfd, 0x49, 0xdd, 0x1b
+	};
+	uint8_t e[C25519_EXPONENT_SIZE] = {0};
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
+
+	e[0] = 40;
+	e[31] = 0x40;
+
+	c25519_smult_xy(x, y, c25519_base_x, c25519_base_y, e);
+	assert(f25519_eq(y, expect_y));
+}
+
+static void test_keygen(void)
+{
+	uint8_t e[C25519_EXPONENT_SIZE];
+	uint8_t p1[F25519_SIZE];
+	uint8_t p2[F25519_SIZE];
+	int i;
+
+	for (i = 0; i < C25519_EXPONENT_SIZE; i++)
+		e[i] = random();
+
+	c25519_smult(p1, c25519_base_x, e);
+	c25519_keygen(p2, e);
+	assert(f25519_eq(p1, p2));
+
+	c25519_prepare(e);
+	c25519_smult(p1, c25519_base_x, e);
+	c25519_keygen(p2, e);
+	assert(f25519_eq(p1, p2));
+}
+
+static void check_smult_xn(int n)
+{
+	uint8_t q[8][F25519_SIZE];
+	uint8_t e[8][C25519_EXPONENT_SIZE];
+	uint8_t r[8][F25519_SIZE];
+	int i;
+
+	for (i = 0; i < n; i++) {
+		int j;
+
+		for (j = 0; j < F25519_SIZE; j++) {
+			q[i][j] = random();
+			e[i][j] = random();
+		}
+	}
+
+	/* Some lanes with the top bit of q set, or a zero result */
+	q[0][31] |= 0x80;
+	memset(q[n - 1], 0, F25519_SIZE);
+
+	if (n == 2)
+		c25519_smult2(r[0], q[0], e[0]);
+	else if (n == 4)
+		c25519_smult_x4(r[0], q[0], e[0]);
+	else
+		c25519_smult_x8(r[0], q[0], e[0]);
+
+	for (i = 0; i < n; i++) {
+		uint8_t s[F25519_SIZE];
+
+		c25519_smult(s, q[i], e[i]);
+		assert(!memcmp(s, r[i], F25519_SIZE));
+	}
+}
+
+static void test_xy_batch(void)
+{
+	uint8_t xP[4][F25519_SIZE];
+	uint8_t yP[4][F25519_SIZE];
+	uint8_t xR[4][F25519_SIZE];
+	uint8_t yR[4][F25519_SIZE];
+	uint8_t e[4][C25519_EXPONENT_SIZE];
+	uint8_t scratch[8][F25519_SIZE];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		int j;
+
+		for (j = 0; j < C25519_EXPONENT_SIZE; j++)
+			e[i][j] = random();
+
+		c25519_prepare(e[i]);
+		c25519_smult_xy(xP[i], yP[i], c25519_base_x, c25519_base_y,
+				e[i]);
+	}
+
+	c25519_smult_xy_batch(xR[0], yR[0], xP[0], yP[0], e[0], 4,
+			      scratch[0]);
+
+	for (i = 0; i < 4; i++) {
+		uint8_t x[F25519_SIZE];
+		uint8_t y[F25519_SIZE];
+
+		c25519_smult_xy(x, y, xP[i], yP[i], e[i]);
+		assert(f25519_eq(x, xR[i]));
+		assert(f25519_eq(y, yR[i]));
+	}
+
+	/* In place */
+	c25519_smult_xy_batch(xP[0], yP[0], xP[0], yP[0], e[0], 4,
+			      scratch[0]);
+	assert(!memcmp(xP, xR, sizeof(xR)));
+	assert(!memcmp(yP, yR, sizeof(yR)));
+}
+
+static void check_peer(const uint8_t *u)
+{
+	static struct c25519_peer_ctx ctx;
+	int i;
+
+	c25519_peer_init(&ctx, u);
+
+	for (i = 0; i < 4; i++) {
+		uint8_t e[C25519_EXPONENT_SIZE];
+		uint8_t r1[F25519_SIZE];
+		uint8_t r2[F25519_SIZE];
+		int j;
+
+		/* The first exponent has a top digit of 8 once recoded */
+		for (j = 0; j < C25519_EXPONENT_SIZE; j++)
+			e[j] = i ? random() : 0xff;
+
+		c25519_smult(r1, u, e);
+		c25519_peer_smult(r2, &ctx, e);
+		assert(f25519_eq(r1, r2));
+	}
+}
+
+static void test_peer(void)
+{
+	uint8_t u[F25519_SIZE];
+	int i;
+
+	/* Random points fall on the curve and the twist about equally */
+	for (i = 0; i < 16; i++) {
+		int j;
+
+		for (j = 0; j < F25519_SIZE; j++)
+			u[j] = random();
+
+		check_peer(u);
+	}
+
+	/* Special points: 0, 1, -1, and the base point with bit 255 set */
+	f25519_load(u, 0);
+	check_peer(u);
+	f25519_load(u, 1);
+	check_peer(u);
+	f25519_neg(u, f25519_one);
+	check_peer(u);
+	f25519_copy(u, c25519_base_x);
+	u[31] |= 0x80;
+	check_peer(u);
+}
+
 int main(void)
 {
 	unsigned int i;
@@ -794,5 +959,31 @@ int main(void)
 	for (i = 0; i < 32; i++)
 		test_dh_xy();
 
+	printf("test_keygen\n");
+	for (i = 0; i < 32; i++)
+		test_keygen();
+
+	printf("test_smult2\n");
+	for (i = 0; i < 8; i++)
+		check_smult_xn(2);
+
+	printf("test_smult_x4\n");
+	for (i = 0; i < 8; i++)
+		check_smult_xn(4);
+
+	printf("test_smult_x8\n");
+	for (i = 0; i < 8; i++)
+		check_smult_xn(8);
+
+	printf("test_xy_batch\n");
+	for (i = 0; i < 4; i++)
+		test_xy_batch();
+
+	printf("test_peer\n");
+	test_peer();
+
+	printf("test_xy_sign\n");
+	test_xy_sign();
+
 	return 0;
 }
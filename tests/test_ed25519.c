@@ -8,6 +8,7 @@
 #include <stdio.h>
 #include <assert.h>
 #include "ed25519.h"
+#include "ed25519_tab.h"
 #include "c25519.h"
 
 static const uint8_t ed25519_order[ED25519_EXPONENT_SIZE] = {
@@ -61,6 +62,34 @@ static void check_valid(const uint8_t *x, const uint8_t *y)
 	assert(f25519_eq(lhs, rhs));
 }
 
+static void check_valid_pt(const struct ed25519_pt *p)
+{
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
+
+	ed25519_unproject(x, y, p);
+	check_valid(x, y);
+}
+
+/* Check that p is valid, and the same point as ref */
+static void check_same_pt(const struct ed25519_pt *ref,
+			  const struct ed25519_pt *p)
+{
+	uint8_t c1[ED25519_PACK_SIZE];
+	uint8_t c2[ED25519_PACK_SIZE];
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
+
+	check_valid_pt(p);
+
+	ed25519_unproject(x, y, ref);
+	ed25519_pack(c1, x, y);
+	ed25519_unproject(x, y, p);
+	ed25519_pack(c2, x, y);
+
+	assert(!memcmp(c1, c2, ED25519_PACK_SIZE));
+}
+
 static void test_pack(void)
 {
 	uint8_t e[ED25519_EXPONENT_SIZE];
@@ -192,6 +221,345 @@ static void test_order(void)
 	assert(f25519_eq(b1, b2));
 }
 
+static void test_batch(void)
+{
+	struct ed25519_pt p[4];
+	uint8_t x[4][F25519_SIZE];
+	uint8_t y[4][F25519_SIZE];
+	uint8_t c[4][ED25519_PACK_SIZE];
+	uint8_t scratch[4][F25519_SIZE];
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		uint8_t e[ED25519_EXPONENT_SIZE];
+		int j;
+
+		for (j = 0; j < ED25519_EXPONENT_SIZE; j++)
+			e[j] = random();
+
+		ed25519_smult(&p[i], &ed25519_base, e);
+	}
+
+	ed25519_unproject_batch(x[0], y[0], p, 4, scratch[0]);
+	ed25519_pack_batch(c[0], p, 4, scratch[0]);
+
+	for (i = 0; i < 4; i++) {
+		uint8_t ex[F25519_SIZE];
+		uint8_t ey[F25519_SIZE];
+		uint8_t ec[ED25519_PACK_SIZE];
+
+		ed25519_unproject(ex, ey, &p[i]);
+		ed25519_pack(ec, ex, ey);
+
+		assert(f25519_eq(ex, x[i]));
+		assert(f25519_eq(ey, y[i]));
+		assert(!memcmp(ec, c[i], ED25519_PACK_SIZE));
+	}
+}
+
+static void check_smult_base(const uint8_t *e)
+{
+	struct ed25519_pt p;
+	struct ed25519_pt q;
+
+	ed25519_smult(&p, &ed25519_base, e);
+	ed25519_smult_base(&q, e);
+	check_same_pt(&p, &q);
+}
+
+static void check_same_niels(const struct ed25519_niels *a,
+			     const struct ed25519_niels *b)
+{
+	assert(f25519_fe_eq(&a->yplusx, &b->yplusx));
+	assert(f25519_fe_eq(&a->yminusx, &b->yminusx));
+	assert(f25519_fe_eq(&a->xy2d, &b->xy2d));
+}
+
+/* Rebuild each of the generated fixed-base tables from B, and check
+ * every entry.
+ */
+static void test_base_tables(void)
+{
+	static struct ed25519_pt p[ED25519_BASE_ODD_SIZE];
+	static struct ed25519_niels n[ED25519_NIELS_TABLE_SIZE];
+	uint8_t scratch[2 * ED25519_BASE_ODD_SIZE][F25519_SIZE];
+	struct ed25519_pt q;
+	int i;
+#if ED25519_COMB == 0
+	int j;
+
+	printf("  base_tab\n");
+	ed25519_niels_table(n, &ed25519_base);
+	for (i = 0; i < 32; i++)
+		for (j = 0; j < 8; j++)
+			check_same_niels(&n[i * 8 + j], &ed25519_base_tab[i][j]);
+
+	printf("  base_tab_carry\n");
+	ed25519_copy(&p[0], &ed25519_base);
+	for (i = 0; i < 256; i++)
+		ed25519_double(&p[0], &p[0]);
+
+	ed25519_niels_batch(n, p, 1, scratch[0]);
+	check_same_niels(&n[0], &ed25519_base_tab_carry);
+#else
+	int j;
+
+	printf("  comb_tab\n");
+	ed25519_copy(&q, &ed25519_base);
+
+	for (j = 0; j < ED25519_COMB_COMBS; j++) {
+		struct ed25519_pt b[ED25519_COMB_TEETH];
+		int t;
+
+		/* b[t] = 2^(s(t + wj)) B */
+		for (t = 0; t < ED25519_COMB_TEETH; t++) {
+			ed25519_copy(&b[t], &q);
+			for (i = 0; i < ED25519_COMB_SPACING; i++)
+				ed25519_double(&q, &q);
+		}
+
+		for (i = 0; i < (1 << (ED25519_COMB_TEETH - 1)); i++) {
+			ed25519_copy(&p[0], &b[0]);
+
+			for (t = 1; t < ED25519_COMB_TEETH; t++) {
+				struct ed25519_pt m;
+
+				ed25519_copy(&m, &b[t]);
+				if (!((i >> (t - 1)) & 1)) {
+					f25519_fe_neg(&m.x, &m.x);
+					f25519_fe_neg(&m.t, &m.t);
+				}
+
+				ed25519_add(&p[0], &p[0], &m);
+			}
+
+			ed25519_niels_batch(n, p, 1, scratch[0]);
+			check_same_niels(&n[0], &ed25519_comb_tab[j][i]);
+		}
+	}
+#endif
+
+	printf("  base_odd\n");
+	ed25519_double(&q, &ed25519_base);
+	ed25519_copy(&p[0], &ed25519_base);
+	for (i = 1; i < ED25519_BASE_ODD_SIZE; i++)
+		ed25519_add(&p[i], &p[i - 1], &q);
+
+	ed25519_niels_batch(n, p, ED25519_BASE_ODD_SIZE, scratch[0]);
+	for (i = 0; i < ED25519_BASE_ODD_SIZE; i++)
+		check_same_niels(&n[i], &ed25519_base_odd[i]);
+}
+
+static void test_smult_base(void)
+{
+	uint8_t e[ED25519_EXPONENT_SIZE];
+	int i;
+
+	/* Every digit at the top of its range, and a carry out */
+	memset(e, 0xff, sizeof(e));
+	check_smult_base(e);
+
+	/* Every digit at the bottom of its range */
+	memset(e, 0x88, sizeof(e));
+	check_smult_base(e);
+
+	memset(e, 0, sizeof(e));
+	check_smult_base(e);
+	check_smult_base(ed25519_order);
+
+	for (i = 0; i < 20; i++) {
+		int j;
+
+		for (j = 0; j < ED25519_EXPONENT_SIZE; j++)
+			e[j] = random();
+
+		check_smult_base(e);
+	}
+}
+
+static void check_smult_vartime(const struct ed25519_pt *p, const uint8_t *e)
+{
+	struct ed25519_pt q;
+	struct ed25519_pt r;
+
+	ed25519_smult(&q, p, e);
+	ed25519_smult_vartime(&r, p, e);
+	check_same_pt(&q, &r);
+}
+
+static void test_smult_vartime(void)
+{
+	uint8_t e[ED25519_EXPONENT_SIZE];
+	struct ed25519_pt p;
+	int i;
+
+	for (i = 0; i < ED25519_EXPONENT_SIZE; i++)
+		e[i] = random();
+
+	ed25519_smult(&p, &ed25519_base, e);
+
+	/* Long runs of ones, which carry out of the top */
+	memset(e, 0xff, sizeof(e));
+	check_smult_vartime(&p, e);
+
+	memset(e, 0, sizeof(e));
+	check_smult_vartime(&p, e);
+	e[0] = 1;
+	check_smult_vartime(&p, e);
+	check_smult_vartime(&p, ed25519_order);
+
+	for (i = 0; i < 10; i++) {
+		int j;
+
+		for (j = 0; j < ED25519_EXPONENT_SIZE; j++)
+			e[j] = random();
+
+		check_smult_vartime(&p, e);
+	}
+}
+
+static void test_double_scalarmult(void)
+{
+	uint8_t a[ED25519_EXPONENT_SIZE];
+	uint8_t b[ED25519_EXPONENT_SIZE];
+	struct ed25519_pt p;
+	struct ed25519_pt q;
+	struct ed25519_pt r;
+	int i;
+
+	for (i = 0; i < ED25519_EXPONENT_SIZE; i++) {
+		a[i] = random();
+		b[i] = random();
+	}
+
+	ed25519_smult(&p, &ed25519_base, a);
+
+	for (i = 0; i < ED25519_EXPONENT_SIZE; i++)
+		a[i] = random();
+
+	/* One exponent much shorter than the other */
+	b[31] = 0;
+	b[30] = 0;
+
+	ed25519_smult(&q, &p, a);
+	ed25519_smult(&r, &ed25519_base, b);
+	ed25519_add(&q, &q, &r);
+
+	ed25519_double_scalarmult_vartime(&r, a, &p, b);
+	check_same_pt(&q, &r);
+}
+
+static void test_add_mixed(void)
+{
+	struct ed25519_pt p[4];
+	struct ed25519_niels n[4];
+	uint8_t scratch[8][F25519_SIZE];
+	uint8_t e[ED25519_EXPONENT_SIZE];
+	struct ed25519_pt q;
+	struct ed25519_pt r;
+	struct ed25519_pt s;
+	int i;
+	int j;
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < ED25519_EXPONENT_SIZE; j++)
+			e[j] = random();
+
+		ed25519_smult(&p[i], &ed25519_base, e);
+	}
+
+	for (j = 0; j < ED25519_EXPONENT_SIZE; j++)
+		e[j] = random();
+
+	ed25519_smult(&q, &ed25519_base, e);
+	ed25519_niels_batch(n, p, 4, scratch[0]);
+
+	for (i = 0; i < 4; i++) {
+		ed25519_add(&r, &q, &p[i]);
+		ed25519_add_mixed(&s, &q, &n[i]);
+		check_same_pt(&r, &s);
+	}
+}
+
+static void check_msm(size_t n)
+{
+	static struct ed25519_pt p[600];
+	static uint8_t e[600][ED25519_EXPONENT_SIZE];
+	static union ed25519_msm_scratch scratch[ED25519_MSM_SCRATCH_MAX];
+	struct ed25519_pt q;
+	struct ed25519_pt r;
+	size_t i;
+
+	assert(n <= 600);
+	assert(ED25519_MSM_SCRATCH(n) <= ED25519_MSM_SCRATCH_MAX);
+	ed25519_copy(&q, &ed25519_neutral);
+
+	for (i = 0; i < n; i++) {
+		int j;
+
+		for (j = 0; j < ED25519_EXPONENT_SIZE; j++)
+			e[i][j] = random();
+
+		ed25519_smult_base(&p[i], e[i]);
+
+		for (j = 0; j < ED25519_EXPONENT_SIZE; j++)
+			e[i][j] = random();
+
+		/* Repeated points and zero exponents */
+		if (i % 7 == 3)
+			ed25519_copy(&p[i], &p[i - 1]);
+		if (i % 11 == 5)
+			memset(e[i], 0, ED25519_EXPONENT_SIZE);
+
+		ed25519_smult(&r, &p[i], e[i]);
+		ed25519_add(&q, &q, &r);
+	}
+
+	ed25519_msm_vartime(&r, e[0], p, n, scratch);
+	check_same_pt(&q, &r);
+}
+
+static void test_msm(void)
+{
+	check_msm(1);
+	check_msm(5);
+	check_msm(40);
+	check_msm(ED25519_MSM_PIPPENGER_MIN);
+	check_msm(600);
+}
+
+static void test_smult2(void)
+{
+	uint8_t e[2][ED25519_EXPONENT_SIZE];
+	struct ed25519_pt p[2];
+	struct ed25519_pt r[2];
+	struct ed25519_pt s;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		int j;
+
+		for (j = 0; j < ED25519_EXPONENT_SIZE; j++)
+			e[i][j] = random();
+
+		ed25519_smult(&p[i], &ed25519_base, e[i]);
+
+		for (j = 0; j < ED25519_EXPONENT_SIZE; j++)
+			e[i][j] = random();
+	}
+
+	ed25519_smult2(r, p, e[0]);
+
+	for (i = 0; i < 2; i++) {
+		ed25519_smult(&s, &p[i], e[i]);
+		assert(!memcmp(&s, &r[i], sizeof(s)));
+	}
+
+	/* In place */
+	ed25519_smult2(p, p, e[0]);
+	assert(!memcmp(p, r, sizeof(r)));
+}
+
 int main(void)
 {
 	int i;
@@ -199,10 +567,13 @@ int main(void)
 	srandom(0);
 
 	printf("check_valid(ed25519_neutral)\n");
-	check_valid(ed25519_neutral.x, ed25519_neutral.y);
+	check_valid_pt(&ed25519_neutral);
 
 	printf("check_valid(ed25519_base)\n");
-	check_valid(ed25519_base.x, ed25519_base.y);
+	check_valid_pt(&ed25519_base);
+
+	printf("test_base_tables\n");
+	test_base_tables();
 
 	printf("test_double_add\n");
 	test_add();
@@ -218,5 +589,31 @@ int main(void)
 	for (i = 0; i < 10; i++)
 		test_dh();
 
+	printf("test_smult2\n");
+	for (i = 0; i < 5; i++)
+		test_smult2();
+
+	printf("test_smult_vartime\n");
+	for (i = 0; i < 5; i++)
+		test_smult_vartime();
+
+	printf("test_double_scalarmult\n");
+	for (i = 0; i < 10; i++)
+		test_double_scalarmult();
+
+	printf("test_add_mixed\n");
+	for (i = 0; i < 5; i++)
+		test_add_mixed();
+
+	printf("test_msm\n");
+	test_msm();
+
+	printf("test_smult_base\n");
+	test_smult_base();
+
+	printf("test_batch\n");
+	for (i = 0; i < 5; i++)
+		test_batch();
+
 	return 0;
 }
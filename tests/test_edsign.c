@@ -1195,6 +1195,98 @@ static void test(const struct test_vector *t)
 	signature[32] ^= 1;
 }
 
+/* Verify n signatures, taken from the vectors in turn, as a batch. If
+ * bad is less than n, that signature is corrupted.
+ */
+#define MAX_BATCH  300
+
+static union ed25519_msm_scratch
+	batch_scratch[EDSIGN_BATCH_SCRATCH(EDSIGN_BATCH_GROUP)];
+
+static void test_batch(unsigned int n, unsigned int bad, size_t group)
+{
+	static uint8_t sig[MAX_BATCH][EDSIGN_SIGNATURE_SIZE];
+	const uint8_t *sigs[MAX_BATCH];
+	const uint8_t *pubs[MAX_BATCH];
+	const uint8_t *msgs[MAX_BATCH];
+	size_t lens[MAX_BATCH];
+	uint8_t results[MAX_BATCH];
+	unsigned int i;
+
+	assert(n <= MAX_BATCH);
+	assert(group <= EDSIGN_BATCH_GROUP);
+
+	for (i = 0; i < n; i++) {
+		const struct test_vector *t = &test_vectors[i % NUM_VECTORS];
+
+		memcpy(sig[i], t->signature, EDSIGN_SIGNATURE_SIZE);
+		sigs[i] = sig[i];
+		pubs[i] = t->public;
+		msgs[i] = t->message;
+		lens[i] = t->mlen;
+	}
+
+	if (bad < n)
+		sig[bad][32] ^= 1;
+
+	assert(edsign_verify_batch(sigs, pubs, msgs, lens, n, results,
+				   group, batch_scratch) == (bad >= n));
+
+	for (i = 0; i < n; i++)
+		assert(results[i] == (i != bad));
+}
+
+/* Signatures with R = 0 and s = 0 under the small-order public key
+ * (0, -1). edsign_verify() accepts them only when z is even, and the
+ * batch check must agree whatever its weights.
+ */
+static void test_batch_small_order(void)
+{
+	static const uint8_t neutral[F25519_SIZE] = {1};
+	static const uint8_t order2[F25519_SIZE] = {
+		0xec, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f
+	};
+	uint8_t sig[EDSIGN_SIGNATURE_SIZE];
+	uint8_t msg[32][1];
+	const uint8_t *sigs[32];
+	const uint8_t *pubs[32];
+	const uint8_t *msgs[32];
+	size_t lens[32];
+	uint8_t results[32];
+	unsigned int accepted = 0;
+	unsigned int i;
+	size_t group;
+
+	memset(sig, 0, sizeof(sig));
+	memcpy(sig, neutral, sizeof(neutral));
+
+	for (i = 0; i < 32; i++) {
+		msg[i][0] = i;
+		sigs[i] = sig;
+		pubs[i] = order2;
+		msgs[i] = msg[i];
+		lens[i] = 1;
+	}
+
+	for (i = 0; i < 32; i++)
+		accepted += edsign_verify(sigs[i], pubs[i], msgs[i], lens[i]);
+
+	/* Both outcomes must occur */
+	assert(accepted > 0 && accepted < 32);
+
+	for (group = 1; group <= 32; group <<= 2) {
+		edsign_verify_batch(sigs, pubs, msgs, lens, 32, results,
+				    group, batch_scratch);
+
+		for (i = 0; i < 32; i++)
+			assert(results[i] == edsign_verify(sigs[i], pubs[i],
+							   msgs[i], lens[i]));
+	}
+}
+
 int main(void)
 {
 	unsigned int i;
@@ -1204,5 +1296,19 @@ int main(void)
 		printf("\n");
 	}
 
+	printf("test_batch\n");
+	test_batch(1, 1, 16);
+	test_batch(1, 0, 16);
+	test_batch(40, 40, 16);
+	test_batch(40, 0, 16);
+	test_batch(40, 21, 16);
+	test_batch(40, 39, 16);
+	test_batch(40, 40, 1);
+	test_batch(MAX_BATCH, MAX_BATCH, EDSIGN_BATCH_GROUP);
+	test_batch(MAX_BATCH, 200, EDSIGN_BATCH_GROUP);
+
+	printf("test_batch_small_order\n");
+	test_batch_small_order();
+
 	return 0;
 }
@@ -137,6 +137,34 @@ static void test_mul(void)
 	assert(f25519_eq(d, e));
 }
 
+static void test_sqr(void)
+{
+	uint8_t a[F25519_SIZE];
+	uint8_t b[F25519_SIZE];
+	uint8_t c[F25519_SIZE];
+	int i;
+
+	randomize(a);
+
+	f25519_mul__distinct(b, a, a);
+	f25519_sqr(c, a);
+
+	f25519_normalize(b);
+	f25519_normalize(c);
+	assert(f25519_eq(b, c));
+
+	/* a^(2^5), by repeated squaring in place */
+	f25519_copy(b, a);
+	for (i = 0; i < 5; i++)
+		f25519_sqr(b, b);
+
+	f25519_sqr_n(c, a, 5);
+
+	f25519_normalize(b);
+	f25519_normalize(c);
+	assert(f25519_eq(b, c));
+}
+
 static void test_distributive(void)
 {
 	uint8_t a[F25519_SIZE];
@@ -212,6 +240,189 @@ static void test_inv(void)
 	assert(f25519_eq(p, one));
 }
 
+static void test_inv_batch(void)
+{
+	uint8_t in[8][F25519_SIZE];
+	uint8_t out[8][F25519_SIZE];
+	uint8_t scratch[8][F25519_SIZE];
+	uint8_t ai[F25519_SIZE];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		randomize(in[i]);
+
+	/* Zero (in un-normalized form) must not spoil the others */
+	memset(in[3], 0, F25519_SIZE);
+	memset(in[5], 0xff, F25519_SIZE);
+	in[5][31] = 0x7f;
+	in[5][0] = 0xed;
+
+	f25519_inv_batch(out[0], in[0], 8, scratch[0]);
+
+	for (i = 0; i < 8; i++) {
+		f25519_inv__distinct(ai, in[i]);
+		f25519_normalize(ai);
+		f25519_normalize(out[i]);
+		assert(f25519_eq(ai, out[i]));
+	}
+
+	/* In place */
+	f25519_inv_batch(in[0], in[0], 8, scratch[0]);
+
+	for (i = 0; i < 8; i++) {
+		f25519_normalize(in[i]);
+		assert(f25519_eq(in[i], out[i]));
+	}
+}
+
+static void test_fe(void)
+{
+	static const struct f25519_fe k = F25519_FE_INIT(
+		0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef,
+		0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10,
+		0x0f, 0x1e, 0x2d, 0x3c, 0x4b, 0x5a, 0x69, 0x78,
+		0x87, 0x96, 0xa5, 0xb4, 0xc3, 0xd2, 0xe1, 0x70);
+	uint8_t a[F25519_SIZE];
+	uint8_t b[F25519_SIZE];
+	uint8_t c[F25519_SIZE];
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
+	struct f25519_fe fa;
+	struct f25519_fe fb;
+	struct f25519_fe fx;
+
+	randomize(a);
+	randomize(b);
+
+	/* Round trip gives the normalized value */
+	f25519_fe_frombytes(&fa, a);
+	f25519_fe_frombytes(&fb, b);
+	f25519_fe_tobytes(x, &fa);
+	f25519_copy(y, a);
+	f25519_normalize(y);
+	assert(f25519_eq(x, y));
+
+	/* 1/(3k((a+b)(a-b))^4 - a), in both forms */
+	f25519_fe_add(&fx, &fa, &fb);
+	f25519_fe_sub(&fb, &fa, &fb);
+	f25519_fe_mul(&fx, &fx, &fb);
+	f25519_fe_sqr(&fx, &fx);
+	f25519_fe_sqr_n(&fx, &fx, 1);
+	f25519_fe_mul_c(&fx, &fx, 3);
+	f25519_fe_mul(&fx, &fx, &k);
+	f25519_fe_neg(&fa, &fa);
+	f25519_fe_add(&fx, &fx, &fa);
+	f25519_fe_inv(&fx, &fx);
+	f25519_fe_tobytes(x, &fx);
+
+	f25519_add(c, a, b);
+	f25519_sub(y, a, b);
+	f25519_mul__distinct(b, c, y);
+	f25519_sqr_n(c, b, 2);
+	f25519_mul_c(b, c, 3);
+	f25519_fe_tobytes(y, &k);
+	f25519_mul__distinct(c, b, y);
+	f25519_sub(b, c, a);
+	f25519_inv__distinct(y, b);
+	f25519_normalize(y);
+	assert(f25519_eq(x, y));
+
+	/* Comparison and selection */
+	f25519_fe_frombytes(&fb, y);
+	assert(f25519_fe_eq(&fx, &fb));
+	assert(!f25519_fe_eq(&fx, &fa));
+	f25519_fe_select(&fb, &fx, &fa, 1);
+	assert(f25519_fe_eq(&fb, &fa));
+	f25519_fe_select(&fb, &fx, &fa, 0);
+	assert(f25519_fe_eq(&fb, &fx));
+}
+
+static void test_lazy(void)
+{
+	uint8_t a[F25519_SIZE];
+	uint8_t b[F25519_SIZE];
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
+	struct f25519_fe fa;
+	struct f25519_fe fb;
+	struct f25519_fe s;
+	struct f25519_fe d;
+	struct f25519_fe r;
+	struct f25519_fe q;
+
+	randomize(a);
+	randomize(b);
+
+	/* Exercise the upper end of the bounds with p-1 */
+	if (random() & 1) {
+		memset(a, 0xff, F25519_SIZE);
+		a[31] = 0x7f;
+		a[0] = 0xec;
+	}
+
+	f25519_fe_frombytes(&fa, a);
+	f25519_fe_frombytes(&fb, b);
+
+	/* (a+b)(a-b), (a-b)^2 and 3(a+b) computed lazily and not */
+	f25519_fe_add_lazy(&s, &fa, &fb);
+	f25519_fe_sub_lazy(&d, &fa, &fb);
+	f25519_fe_mul(&r, &s, &d);
+	f25519_fe_add(&q, &fa, &fb);
+	f25519_fe_sub(&fb, &fa, &fb);
+	f25519_fe_mul(&q, &q, &fb);
+	f25519_fe_tobytes(x, &r);
+	f25519_fe_tobytes(y, &q);
+	assert(f25519_eq(x, y));
+
+	f25519_fe_sqr(&r, &d);
+	f25519_fe_sqr(&q, &fb);
+	assert(f25519_fe_eq(&r, &q));
+
+	f25519_fe_mul_c(&r, &s, 3);
+	f25519_fe_add(&q, &s, &s);
+	f25519_fe_add(&q, &q, &s);
+	assert(f25519_fe_eq(&r, &q));
+
+	/* Subtracting from zero */
+	f25519_fe_sub_lazy(&d, &f25519_fe_zero, &fa);
+	f25519_fe_neg(&q, &fa);
+	f25519_fe_tobytes(x, &d);
+	f25519_fe_tobytes(y, &q);
+	assert(f25519_eq(x, y));
+}
+
+static void test_sqrt_ratio(void)
+{
+	uint8_t a[F25519_SIZE];
+	uint8_t u[F25519_SIZE];
+	uint8_t v[F25519_SIZE];
+	uint8_t x[F25519_SIZE];
+	uint8_t y[F25519_SIZE];
+
+	randomize(a);
+	randomize(v);
+
+	/* u = a^2 v, so u/v = a^2 */
+	f25519_sqr(y, a);
+	f25519_mul__distinct(u, y, v);
+
+	assert(f25519_sqrt_ratio(x, u, v));
+	f25519_sqr(y, x);
+	f25519_normalize(y);
+	f25519_sqr(x, a);
+	f25519_normalize(x);
+	assert(f25519_eq(x, y));
+
+	/* 2 is not a square mod p, so neither is 2a^2 */
+	f25519_mul_c(u, u, 2);
+	assert(!f25519_sqrt_ratio(x, u, v));
+
+	/* 0/v = 0 */
+	assert(f25519_sqrt_ratio(x, f25519_zero, v));
+	f25519_normalize(x);
+	assert(f25519_eq(x, f25519_zero));
+}
+
 int main(void)
 {
 	int i;
@@ -240,6 +451,10 @@ int main(void)
 	for (i = 0; i < 100; i++)
 		test_mul();
 
+	printf("test_sqr\n");
+	for (i = 0; i < 100; i++)
+		test_sqr();
+
 	printf("test_distributive\n");
 	for (i = 0; i < 100; i++)
 		test_distributive();
@@ -248,9 +463,25 @@ int main(void)
 	for (i = 0; i < 100; i++)
 		test_inv();
 
+	printf("test_inv_batch\n");
+	for (i = 0; i < 20; i++)
+		test_inv_batch();
+
+	printf("test_fe\n");
+	for (i = 0; i < 100; i++)
+		test_fe();
+
+	printf("test_lazy\n");
+	for (i = 0; i < 100; i++)
+		test_lazy();
+
 	printf("test_sqrt\n");
 	for (i = 0; i < 100; i++)
 		test_sqrt();
 
+	printf("test_sqrt_ratio\n");
+	for (i = 0; i < 100; i++)
+		test_sqrt_ratio();
+
 	return 0;
 }
@@ -0,0 +1,306 @@
+/* Background pool of ephemeral Curve25519 keypairs
+ *
+ * This file is in the public domain.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <pthread.h>
+#include "keypool.h"
+
+#define CONSUMERS	4
+#define PER_CONSUMER	32
+
+/* More consumers than slots, so that slots are handed back out of
+ * order.
+ */
+#define CROWD		8
+#define CROWD_LIMIT	8192
+
+/* Deterministic source: every call draws a fresh counter value, so no
+ * two secrets are alike. Fails once the limit is reached.
+ */
+struct counter_rng {
+	uint32_t	next;
+	uint32_t	limit;
+};
+
+static int counter_rng(void *arg, uint8_t *buf, size_t len)
+{
+	struct counter_rng *c = arg;
+	const uint32_t v = __atomic_fetch_add(&c->next, 1, __ATOMIC_RELAXED);
+	size_t i;
+
+	if (v >= c->limit)
+		return -1;
+
+	for (i = 0; i < len; i++)
+		buf[i] = (v >> ((i & 3) * 8)) ^ (i * 0x3b);
+
+	return 0;
+}
+
+static uint32_t secret_id(const uint8_t *secret)
+{
+	/* Bytes 0 and 31 are altered by clamping, but 4..7 aren't */
+	return ((uint32_t)(secret[4] ^ 0xec)) |
+		((uint32_t)(secret[5] ^ 0x27) << 8) |
+		((uint32_t)(secret[6] ^ 0x62) << 16) |
+		((uint32_t)(secret[7] ^ 0x9d) << 24);
+}
+
+static uint32_t pair_id(const struct keypool_pair *kp)
+{
+	return secret_id(kp->secret);
+}
+
+/* As counter_rng, but also records which thread drew each value, so
+ * that we can tell pairs made by the worker from those made inline.
+ */
+struct tagged_rng {
+	struct counter_rng	c;
+	pthread_t		who[CROWD_LIMIT];
+};
+
+static int tagged_rng(void *arg, uint8_t *buf, size_t len)
+{
+	struct tagged_rng *t = arg;
+
+	if (counter_rng(&t->c, buf, len))
+		return -1;
+
+	t->who[secret_id(buf)] = pthread_self();
+	return 0;
+}
+
+static int from_ring(const struct tagged_rng *t,
+		     const struct keypool_pair *kp)
+{
+	return !pthread_equal(t->who[pair_id(kp)], pthread_self());
+}
+
+static void check_pair(const struct keypool_pair *kp)
+{
+	uint8_t secret[C25519_EXPONENT_SIZE];
+	uint8_t pub[F25519_SIZE];
+
+	memcpy(secret, kp->secret, sizeof(secret));
+	c25519_prepare(secret);
+	assert(!memcmp(secret, kp->secret, sizeof(secret)));
+
+	c25519_smult(pub, c25519_base_x, kp->secret);
+	assert(!memcmp(pub, kp->pub, sizeof(pub)));
+}
+
+static void test_single(void)
+{
+	struct counter_rng rng = { 0, 1000 };
+	struct keypool *p = keypool_create(4, counter_rng, &rng);
+	uint32_t seen[16];
+	int i;
+
+	assert(p);
+
+	for (i = 0; i < 16; i++) {
+		struct keypool_pair kp;
+		int j;
+
+		assert(!keypool_pop(p, &kp));
+		check_pair(&kp);
+
+		seen[i] = pair_id(&kp);
+		for (j = 0; j < i; j++)
+			assert(seen[j] != seen[i]);
+	}
+
+	keypool_destroy(p);
+}
+
+struct consumer {
+	pthread_t		thread;
+	struct keypool		*pool;
+	struct keypool_pair	pairs[PER_CONSUMER];
+};
+
+static void *consume(void *arg)
+{
+	struct consumer *c = arg;
+	int i;
+
+	for (i = 0; i < PER_CONSUMER; i++)
+		assert(!keypool_pop(c->pool, &c->pairs[i]));
+
+	return NULL;
+}
+
+static void test_concurrent(void)
+{
+	struct counter_rng rng = { 0, 1000 };
+	struct keypool *p = keypool_create(8, counter_rng, &rng);
+	struct consumer cs[CONSUMERS];
+	uint8_t seen[1000] = {0};
+	int i;
+
+	assert(p);
+
+	for (i = 0; i < CONSUMERS; i++) {
+		cs[i].pool = p;
+		assert(!pthread_create(&cs[i].thread, NULL, consume, &cs[i]));
+	}
+
+	for (i = 0; i < CONSUMERS; i++) {
+		int j;
+
+		pthread_join(cs[i].thread, NULL);
+
+		for (j = 0; j < PER_CONSUMER; j++) {
+			const struct keypool_pair *kp = &cs[i].pairs[j];
+			const uint32_t id = pair_id(kp);
+
+			check_pair(kp);
+			assert(id < sizeof(seen));
+			assert(!seen[id]);
+			seen[id] = 1;
+		}
+	}
+
+	keypool_destroy(p);
+}
+
+struct crowd_member {
+	pthread_t		thread;
+	struct keypool		*pool;
+	struct tagged_rng	*rng;
+	int			ring;
+	uint32_t		ids[PER_CONSUMER];
+};
+
+static void *crowd_consume(void *arg)
+{
+	struct crowd_member *c = arg;
+	int i;
+
+	for (i = 0; i < PER_CONSUMER; i++) {
+		struct keypool_pair kp;
+
+		assert(!keypool_pop(c->pool, &kp));
+		check_pair(&kp);
+
+		c->ids[i] = pair_id(&kp);
+		if (from_ring(c->rng, &kp))
+			c->ring++;
+	}
+
+	return NULL;
+}
+
+static void test_crowd(void)
+{
+	static struct tagged_rng rng;
+	static uint8_t seen[CROWD_LIMIT];
+	const struct timespec tick = { 0, 1000000 };
+	struct crowd_member cs[CROWD];
+	struct keypool *p;
+	int ring = 0;
+	int i;
+
+	rng.c.limit = CROWD_LIMIT;
+	p = keypool_create(2, tagged_rng, &rng);
+	assert(p);
+
+	for (i = 0; i < CROWD; i++) {
+		cs[i].pool = p;
+		cs[i].rng = &rng;
+		cs[i].ring = 0;
+		assert(!pthread_create(&cs[i].thread, NULL,
+				       crowd_consume, &cs[i]));
+	}
+
+	for (i = 0; i < CROWD; i++) {
+		int j;
+
+		pthread_join(cs[i].thread, NULL);
+		ring += cs[i].ring;
+
+		for (j = 0; j < PER_CONSUMER; j++) {
+			const uint32_t id = cs[i].ids[j];
+
+			assert(id < sizeof(seen));
+			assert(!seen[id]);
+			seen[id] = 1;
+		}
+	}
+
+	assert(ring > 0);
+
+	/* The ring must still be in working order: each time we drain
+	 * it, the worker must fill it again.
+	 */
+	for (i = 0; i < 16; i++) {
+		int tries;
+
+		for (tries = 0; tries < 2000; tries++) {
+			struct keypool_pair kp;
+
+			assert(!keypool_pop(p, &kp));
+			check_pair(&kp);
+
+			if (from_ring(&rng, &kp))
+				break;
+
+			nanosleep(&tick, NULL);
+		}
+
+		assert(tries < 2000);
+	}
+
+	keypool_destroy(p);
+}
+
+static void test_rng_failure(void)
+{
+	struct counter_rng rng = { 0, 3 };
+	struct keypool *p = keypool_create(8, counter_rng, &rng);
+	struct keypool_pair kp;
+	int ok = 0;
+	int i;
+
+	assert(p);
+
+	/* Only three pairs can ever be made, by the worker or inline */
+	for (i = 0; i < 8; i++)
+		if (!keypool_pop(p, &kp)) {
+			check_pair(&kp);
+			ok++;
+		}
+
+	assert(ok <= 3);
+	assert(keypool_pop(p, &kp) < 0);
+
+	/* Once the worker has given up, we're told so */
+	while ((i = keypool_pop(p, &kp)) == -1)
+		;
+
+	assert(i == -2);
+
+	keypool_destroy(p);
+}
+
+int main(void)
+{
+	printf("test_single\n");
+	test_single();
+
+	printf("test_concurrent\n");
+	test_concurrent();
+
+	printf("test_crowd\n");
+	test_crowd();
+
+	printf("test_rng_failure\n");
+	test_rng_failure();
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+/* Constant-time modular inversion
+ *
+ * This file is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "modinv.h"
+#include "fprime.h"
+
+/* 2^255 - 19 */
+static const uint8_t p25519[FPRIME_SIZE] = {
+	0xed, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x7f
+};
+
+/* 2^252 + 27742317777372353535851937790883648493 */
+static const uint8_t order[FPRIME_SIZE] = {
+	0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+	0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10
+};
+
+static void test_init(const uint8_t *modulus)
+{
+	struct modinv_modulus m;
+	uint64_t m0 = 0;
+	int i;
+
+	modinv_init(&m, modulus);
+
+	for (i = 7; i >= 0; i--)
+		m0 = (m0 << 8) | modulus[i];
+
+	assert((((m0 * m.inv62) << 2) >> 2) == 1);
+}
+
+#if MODINV_SAFEGCD
+
+static void check_inv(const uint8_t *x, const struct modinv_modulus *m,
+		      const uint8_t *modulus)
+{
+	uint8_t r[MODINV_SIZE];
+	uint8_t p[MODINV_SIZE];
+
+	modinv(r, x, m);
+
+	/* Fully reduced */
+	fprime_copy(p, r);
+	fprime_normalize(p, modulus);
+	assert(fprime_eq(p, r));
+
+	fprime_mul(p, r, x, modulus);
+
+	if (fprime_eq(x, fprime_zero))
+		assert(fprime_eq(r, fprime_zero));
+	else
+		assert(fprime_eq(p, fprime_one));
+}
+
+static void test_inv(const uint8_t *modulus)
+{
+	struct modinv_modulus m;
+	uint8_t x[MODINV_SIZE];
+	int i;
+
+	modinv_init(&m, modulus);
+
+	check_inv(fprime_zero, &m, modulus);
+	check_inv(fprime_one, &m, modulus);
+
+	/* m - 1 */
+	fprime_copy(x, modulus);
+	x[0]--;
+	check_inv(x, &m, modulus);
+
+	for (i = 0; i < 100; i++) {
+		int j;
+
+		for (j = 0; j < MODINV_SIZE; j++)
+			x[j] = random();
+
+		fprime_normalize(x, modulus);
+		check_inv(x, &m, modulus);
+	}
+}
+
+#endif
+
+int main(void)
+{
+	srandom(0);
+
+	printf("test_init\n");
+	test_init(p25519);
+	test_init(order);
+
+#if MODINV_SAFEGCD
+	printf("test_inv(p25519)\n");
+	test_inv(p25519);
+
+	printf("test_inv(order)\n");
+	test_inv(order);
+#endif
+
+	return 0;
+}
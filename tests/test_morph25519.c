@@ -109,12 +109,15 @@ static void test_sm(void)
 
 int main(void)
 {
+	uint8_t base_x[F25519_SIZE];
+	uint8_t base_y[F25519_SIZE];
 	int i;
 
 	srandom(0);
+	ed25519_unproject(base_x, base_y, &ed25519_base);
 
 	printf("test_base\n");
-	test_morph(c25519_base_x, ed25519_base.x, ed25519_base.y);
+	test_morph(c25519_base_x, base_x, base_y);
 
 	printf("test_sm\n");
 	for (i = 0; i < 32; i++)
@@ -136,7 +139,7 @@ int main(void)
 	test_morph_wx2wy(Gy, Gx);
 
 	printf("test_morph_e2w\n");
-	test_morph_e2w(ed25519_base.x, ed25519_base.y);
+	test_morph_e2w(base_x, base_y);
 
 	return 0;
 }